@@ -0,0 +1,29 @@
+#!/bin/sh
+# Times the GOSUB and DEF FN benchmarks. Given a second binary built with
+# inlining off, also times the FN calls without inlining.
+#
+#   g++ zuix.cpp -o zuix -std=c++11 -pthread -O2
+#   g++ zuix.cpp -o zuix-noinline -std=c++11 -pthread -O2 -DZUIX_INLINE_NODES=0
+#   sh bench/calls.sh ./zuix [./zuix-noinline]
+
+ZUIX=${1:-./zuix}
+NOINLINE=$2
+DIR=$(dirname "$0")
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+# run BINARY PROGRAM LABEL
+run() {
+    START=$(now_ms)
+    RESULT=$( (cat "$DIR/$2"; echo RUN; echo EXIT) | "$1" | grep -a '^A> [0-9-]' | tail -1)
+    echo "$3 time=$(( $(now_ms) - START ))ms result=${RESULT#A> }"
+}
+
+run "$ZUIX" fib_gosub.bas "fib(25) via GOSUB:"
+run "$ZUIX" gosub_calls.bas "300k GOSUB/RETURN:"
+run "$ZUIX" fn_calls.bas "2M FNSQ(I), inlined:"
+if [ -n "$NOINLINE" ]; then
+    run "$NOINLINE" fn_calls.bas "2M FNSQ(I), not inlined:"
+fi
@@ -0,0 +1,31 @@
+// Reads BIG.CSV through the file channel layer alone, without statement
+// dispatch, and prints MB/s for readLine and readField. Run by csv.sh:
+//
+//   g++ bench/channel_layer.cpp -o channel_layer -std=c++11 -pthread -O2
+#define main zuix_main
+#include "../zuix.cpp"
+#undef main
+
+int main() {
+    processOpen("OPEN \"BIG.CSV\" FOR INPUT AS #1");
+    processOpen("OPEN \"BIG.CSV\" FOR INPUT AS #2");
+    if (vm->channels.size() != 2) return 1;
+    FileChannel& lines = *vm->channels[1];
+    FileChannel& fields = *vm->channels[2];
+    double megabytes = lines.size() / 1e6;
+
+    auto start = std::chrono::steady_clock::now();
+    std::string text;
+    size_t lineCount = 0;
+    while (lines.readLine(text)) lineCount++;
+    auto middle = std::chrono::steady_clock::now();
+    size_t fieldCount = 0;
+    while (fields.readField(text)) fieldCount++;
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << "readLine: " << lineCount << " lines, "
+              << megabytes / std::chrono::duration<double>(middle - start).count() << " MB/s\n"
+              << "readField: " << fieldCount << " fields, "
+              << megabytes / std::chrono::duration<double>(end - middle).count() << " MB/s\n";
+    return 0;
+}
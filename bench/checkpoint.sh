@@ -0,0 +1,31 @@
+#!/bin/sh
+# Times writing and restoring the checkpoint of bench/checkpoint_big.bas
+# (a DIM A(10000000) program). The write time is the run minus the same
+# run without its CHECKPOINT line. Files go to a scratch directory.
+#
+#   g++ zuix.cpp -o zuix -std=c++11 -pthread -O2
+#   sh bench/checkpoint.sh ./zuix
+
+ZUIX=$(cd "$(dirname "${1:-./zuix}")" && pwd)/$(basename "${1:-./zuix}")
+PROGRAM=$(cd "$(dirname "$0")" && pwd)/checkpoint_big.bas
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+START=$(now_ms)
+(grep -v CHECKPOINT "$PROGRAM"; echo RUN; echo EXIT) | "$ZUIX" > /dev/null
+BASE=$(( $(now_ms) - START ))
+
+START=$(now_ms)
+(cat "$PROGRAM"; echo RUN; echo EXIT) | "$ZUIX" > /dev/null
+WRITE=$(( $(now_ms) - START - BASE ))
+
+START=$(now_ms)
+RESULT=$( (echo 'CONT "BIG.CHK"'; echo EXIT) | "$ZUIX" | grep -a '^A> [0-9-]' | tail -1)
+RESTORE=$(( $(now_ms) - START ))
+
+echo "size=$(wc -c < BIG.CHK) bytes write=${WRITE}ms restore=${RESTORE}ms result=${RESULT#A> }"
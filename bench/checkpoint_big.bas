@@ -0,0 +1,5 @@
+10 REM 80 MB CHECKPOINT WRITE AND RESTORE, RUN BY CHECKPOINT.SH
+20 DIM A(10000000)
+30 LET A(10000000) = 42
+40 CHECKPOINT "BIG.CHK"
+50 PRINT A(10000000)
@@ -0,0 +1,43 @@
+#!/bin/sh
+# Writes a CSV with bench/csv_write.bas (51M rows, about 1.19 GB, by
+# default), then times reading it with INPUT # and LINE INPUT #. Given the
+# channel_layer driver, also times the channel layer alone. Files go to a
+# scratch directory.
+#
+#   g++ zuix.cpp -o zuix -std=c++11 -pthread -O2
+#   g++ bench/channel_layer.cpp -o channel_layer -std=c++11 -pthread -O2
+#   sh bench/csv.sh ./zuix [rows] [./channel_layer]
+
+absolute() {
+    echo "$(cd "$(dirname "$1")" && pwd)/$(basename "$1")"
+}
+
+ZUIX=$(absolute "${1:-./zuix}")
+ROWS=${2:-51000000}
+LAYER=${3:+$(absolute "$3")}
+DIR=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+# run PROGRAM LABEL - the write program gets ROWS substituted in
+run() {
+    START=$(now_ms)
+    RESULT=$( (sed "s/51000000/$ROWS/" "$DIR/$1"; echo RUN; echo EXIT) | "$ZUIX" |
+              grep -a '^A> [0-9-]' | tail -1)
+    ELAPSED=$(( $(now_ms) - START ))
+    BYTES=$(wc -c < BIG.CSV)
+    echo "$2 time=${ELAPSED}ms $(( BYTES / (ELAPSED > 0 ? ELAPSED : 1) / 1000 )) MB/s${RESULT:+ result=${RESULT#A> }}"
+}
+
+run csv_write.bas "write via PRINT #1:"
+echo "file: $(wc -c < BIG.CSV) bytes, $ROWS rows"
+run csv_read.bas "read via INPUT #1, A, B, C\$:"
+run csv_lines.bas "read via LINE INPUT #1, L\$:"
+if [ -n "$LAYER" ]; then
+    "$LAYER"
+fi
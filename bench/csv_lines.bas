@@ -0,0 +1,8 @@
+10 REM READ BIG.CSV LINE BY LINE, RUN BY CSV.SH
+20 OPEN "BIG.CSV" FOR INPUT AS #1
+30 LET N = 0
+40 IF EOF(1) THEN 80
+50 LINE INPUT #1, L$
+60 LET N = N + 1
+70 GOTO 40
+80 PRINT N
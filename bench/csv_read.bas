@@ -0,0 +1,8 @@
+10 REM READ BIG.CSV FIELD BY FIELD, RUN BY CSV.SH
+20 OPEN "BIG.CSV" FOR INPUT AS #1
+30 LET T = 0
+40 IF EOF(1) THEN 80
+50 INPUT #1, A, B, C$
+60 LET T = T + B
+70 GOTO 40
+80 PRINT T
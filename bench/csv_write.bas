@@ -0,0 +1,6 @@
+10 REM WRITE A 51M-ROW, 1.19 GB CSV, RUN BY CSV.SH
+20 OPEN "BIG.CSV" FOR OUTPUT AS #1
+30 FOR I = 1 TO 51000000
+40 PRINT #1, I, I * 0.5, "ITEM"
+50 NEXT I
+60 CLOSE #1
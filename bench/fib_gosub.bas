@@ -0,0 +1,15 @@
+10 REM RECURSIVE-STYLE FIBONACCI VIA GOSUB, RUN BY CALLS.SH
+20 LET N = 25
+30 LET R = 0
+40 GOSUB 100
+50 PRINT R
+60 END
+100 IF N < 2 THEN 170
+110 LET N = N - 1
+120 GOSUB 100
+130 LET N = N - 1
+140 GOSUB 100
+150 LET N = N + 2
+160 RETURN
+170 LET R = R + N
+180 RETURN
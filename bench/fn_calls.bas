@@ -0,0 +1,7 @@
+10 REM 2M CALLS TO A SMALL DEF FN, RUN BY CALLS.SH
+20 DEF FNSQ(X) = X * X + 1
+30 LET S = 0
+40 FOR I = 1 TO 2000000
+50 LET S = S + FNSQ(I)
+60 NEXT I
+70 PRINT S
@@ -0,0 +1,9 @@
+10 REM 300K GOSUB/RETURN ROUND TRIPS, RUN BY CALLS.SH
+20 LET S = 0
+30 FOR I = 1 TO 300000
+40 GOSUB 100
+50 NEXT I
+60 PRINT S
+70 END
+100 LET S = S + I * I + 1
+110 RETURN
@@ -0,0 +1,17 @@
+10 REM PARALLEL FOR SCALING BENCHMARK, RUN BY PARALLEL_SCALING.SH
+20 DIM A(2000000)
+30 DIM B(2000000)
+40 LET C = 3
+50 PARALLEL FOR I = 0 TO 2000000
+60 B(I) = I
+70 NEXT I
+80 FOR R = 1 TO 10
+90 PARALLEL FOR I = 0 TO 2000000
+100 A(I) = SQRT(B(I)) * C + SIN(B(I)) * COS(B(I))
+110 NEXT I
+120 NEXT R
+130 LET S = 0
+140 PARALLEL FOR I = 0 TO 2000000 SUM S
+150 S = S + A(I)
+160 NEXT I
+170 PRINT S
@@ -0,0 +1,26 @@
+#!/bin/sh
+# Times bench/parallel_for.bas with ZUIX_THREADS=1..N (default: all cores)
+# and prints the speedup over one thread.
+#
+#   g++ zuix.cpp -o zuix -std=c++11 -pthread -O2
+#   sh bench/parallel_scaling.sh ./zuix [N]
+
+ZUIX=${1:-./zuix}
+MAX=${2:-$(nproc 2>/dev/null || echo 4)}
+PROGRAM=$(dirname "$0")/parallel_for.bas
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+BASE=0
+THREADS=1
+while [ "$THREADS" -le "$MAX" ]; do
+    START=$(now_ms)
+    RESULT=$( (cat "$PROGRAM"; echo RUN; echo EXIT) | ZUIX_THREADS=$THREADS "$ZUIX" |
+              grep -a '^A> [0-9-]' | tail -1)
+    ELAPSED=$(( $(now_ms) - START ))
+    [ "$BASE" -eq 0 ] && BASE=$ELAPSED
+    echo "threads=$THREADS time=${ELAPSED}ms speedup=$(( BASE * 100 / ELAPSED ))% result=${RESULT#A> }"
+    THREADS=$(( THREADS * 2 > MAX && THREADS < MAX ? MAX : THREADS * 2 ))
+done
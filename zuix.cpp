@@ -6,16 +6,34 @@
 #include <algorithm>
 #include <vector>
 #include <cmath>
+#include <cstring>
 #include <random>
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <csignal>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <set>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <climits>
 
 #ifdef _WIN32
     #include <conio.h>
 #else
     #include <termios.h>
     #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
     
     char _getch() {
         char buf = 0;
@@ -45,7 +63,208 @@ struct Variable {
     std::string strValue;  // For string variables
 };
 
-std::vector<Variable> variables;
+struct Line {
+    int number;
+    std::string content;
+};
+
+struct ForLoop {
+    std::string variable;
+    double start;
+    double end;
+    double step;
+    size_t returnLine;
+};
+
+struct StringVariable {
+    std::string name;
+    std::string value;
+};
+
+struct Array {
+    std::string name;
+    std::vector<double> values;
+    int dimensions[3];  // Support up to 3D arrays, -1 when unused
+};
+
+// A compiled expression tree. Source text is parsed once and cached per
+// machine; DEF FN bodies are compiled with their parameters as frame slots.
+struct Expr {
+    enum Kind { NUMBER, VARIABLE, PARAM, NEGATE, BINARY, BUILTIN, USER_FN, ARRAY, FILE_FN };
+    Kind kind = NUMBER;
+    double number = 0;
+    std::string name;                   // VARIABLE, USER_FN, ARRAY or FILE_FN name
+    int slot = 0;                       // PARAM frame index
+    char op = 0;                        // BINARY operator, see applyOperator()
+    double (*builtin)(double) = nullptr;
+    std::vector<std::shared_ptr<Expr>> args;
+};
+
+typedef std::shared_ptr<Expr> ExprPtr;
+
+struct UserFunction {
+    std::vector<std::string> params;
+    std::string source;  // Body text, kept for checkpoints
+    ExprPtr body;
+};
+
+// A data file opened with OPEN ... AS #n. Sequential output goes through
+// a 1 MB stdio buffer. Sequential input reads a memory-mapped view of the
+// file where the platform allows it, otherwise 1 MB windows of it.
+struct FileChannel {
+    enum Mode { INPUT, OUTPUT, APPEND, RANDOM };
+    static const size_t bufferSize = 1 << 20;
+    static const size_t maxRecordLength = 32767;
+
+    Mode mode = INPUT;
+    FILE* file = nullptr;
+    size_t length = 0;          // Size at OPEN, for LOF on input files
+
+    const char* cur = nullptr;  // Unread input
+    const char* end = nullptr;
+    void* mapping = nullptr;    // Covers length bytes when set
+    std::vector<char> window;
+    std::vector<char> buffer;   // stdio buffer for OUTPUT and APPEND
+
+    size_t recordLength = 128;  // RANDOM files: LEN=
+    size_t nextRecord = 1;
+    std::vector<char> record;
+    std::vector<std::pair<std::string, size_t>> fields;  // FIELD variable, width
+
+    FileChannel() = default;
+    FileChannel(const FileChannel&) = delete;
+    FileChannel& operator=(const FileChannel&) = delete;
+
+    ~FileChannel() {
+#ifndef _WIN32
+        if (mapping) munmap(mapping, length);
+#endif
+        if (file) fclose(file);
+    }
+
+    // Load the next window of an unmapped input file; false at end of file
+    bool refill() {
+        if (mapping || !file) return false;
+        window.resize(bufferSize);
+        size_t got = fread(window.data(), 1, window.size(), file);
+        cur = window.data();
+        end = cur + got;
+        return got > 0;
+    }
+
+    bool atEnd() {
+        return cur == end && !refill();
+    }
+
+    // Heap bytes held for this channel, counted against maxMemory
+    size_t footprint() const {
+        return window.capacity() + buffer.capacity() + record.capacity();
+    }
+
+    // Append input up to the first stop character to text and consume the
+    // stop; returns the stop, or 0 at end of file
+    char readUntil(char stop, char otherStop, std::string& text) {
+        while (!atEnd()) {
+            const char* p = cur;
+            if (stop == otherStop) {
+                p = static_cast<const char*>(memchr(cur, stop, end - cur));
+                if (!p) p = end;
+            } else {
+                while (p < end && *p != stop && *p != otherStop) p++;
+            }
+            text.append(cur, p);
+            cur = p;
+            if (p < end) {
+                cur++;
+                return *p;
+            }
+        }
+        return 0;
+    }
+
+    bool readLine(std::string& line) {
+        line.clear();
+        if (atEnd()) return false;
+        readUntil('\n', '\n', line);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        return true;
+    }
+
+    // One comma or newline separated value, quotes removed
+    bool readField(std::string& field) {
+        field.clear();
+        while (!atEnd() && (*cur == ' ' || *cur == '\r' || *cur == '\n')) cur++;
+        if (atEnd()) return false;
+        if (*cur == '"') {
+            cur++;
+            readUntil('"', '"', field);
+            std::string rest;
+            readUntil(',', '\n', rest);
+        } else {
+            readUntil(',', '\n', field);
+            while (!field.empty() && (field.back() == '\r' || field.back() == ' ')) {
+                field.pop_back();
+            }
+        }
+        return true;
+    }
+
+    size_t size() {
+        if (mode == INPUT) return length;
+        long pos = ftell(file);
+        fseek(file, 0, SEEK_END);
+        long total = ftell(file);
+        fseek(file, pos, SEEK_SET);
+        return total < 0 ? 0 : static_cast<size_t>(total);
+    }
+};
+
+const size_t maxGosubDepth = 256;
+
+// Everything one running BASIC program owns. The console session is one
+// Machine; the scheduler runs many of them side by side.
+struct Machine {
+    std::vector<Line> program;
+    std::vector<Variable> variables;
+    std::vector<StringVariable> stringVars;
+    std::vector<Array> arrays;
+    std::vector<std::string> dataValues;
+    size_t dataPointer = 0;
+    std::vector<ForLoop> forLoops;
+    size_t gosubStack[maxGosubDepth];  // Return line indexes for GOSUB/RETURN
+    size_t gosubDepth = 0;
+    std::vector<int> lineTargets;  // GOTO/GOSUB/THEN target index per line, -1 if none
+    std::map<std::string, UserFunction> functions;
+    std::unordered_map<std::string, ExprPtr> exprCache;
+    std::map<int, std::unique_ptr<FileChannel>> channels;  // OPEN ... AS #n
+    int currentLine = 0;
+    bool isRunning = false;
+    bool canContinue = false;  // Set by STOP/Ctrl-C, cleared by edits
+
+    std::string checkpointFile;           // Target for periodic and SIGTERM snapshots
+    unsigned long checkpointInterval = 0; // Lines between snapshots, 0 = off
+    unsigned long linesSinceCheckpoint = 0;
+
+    // Interactive machines read std::cin; the others suspend on INPUT
+    // until a line is queued in pendingInput
+    bool interactive = true;
+    std::ostream* out = &std::cout;
+    std::deque<std::string> pendingInput;
+
+    // Resource limits, 0 = unlimited
+    unsigned long long instructionCount = 0;
+    unsigned long long maxInstructions = 0;
+    size_t maxMemory = 0;
+    std::chrono::milliseconds maxWallTime{0};
+    std::chrono::steady_clock::time_point startTime;
+};
+
+Machine console;
+thread_local Machine* vm = &console;  // Machine the current thread is running
+
+// Set by the Ctrl-C and SIGTERM handlers, acted on between lines
+volatile std::sig_atomic_t breakRequested = 0;
+volatile std::sig_atomic_t terminateRequested = 0;
 
 void clearScreen() {
     std::cout << "\x1B[2J\x1B[H";
@@ -69,13 +288,24 @@ void showHelp() {
     std::cout << "GOTO    - Jump to line number\n";
     std::cout << "FOR     - FOR loop (FOR I=1 TO 10)\n";
     std::cout << "NEXT    - End FOR loop\n";
+    std::cout << "PARALLEL FOR - Multi-core loop (PARALLEL FOR I=1 TO N SUM S)\n";
     std::cout << "IF      - Conditional (IF X=10 THEN)\n";
     std::cout << "REM     - Comment line\n";
     std::cout << "INPUT   - Input value\n";
+    std::cout << "OPEN    - Open file (OPEN \"F\" FOR INPUT AS #1)\n";
+    std::cout << "CLOSE   - Close files (CLOSE #1)\n";
+    std::cout << "PRINT # - Write to file (PRINT #1, A; B$)\n";
+    std::cout << "INPUT # - Read from file (INPUT #1, A, B$)\n";
+    std::cout << "GET/PUT - Random access records (GET #1, 5)\n";
     std::cout << "DATA    - Define data values\n";
     std::cout << "READ    - Read from DATA\n";
     std::cout << "RESTORE - Reset DATA pointer\n";
     std::cout << "END     - End program\n";
+    std::cout << "STOP    - Break program (CONT resumes)\n";
+    std::cout << "DEF FN  - User function (DEF FNSQ(X)=X*X)\n";
+    std::cout << "GOSUB   - Call subroutine (RETURN goes back)\n";
+    std::cout << "CONT    - Continue program (CONT \"file\")\n";
+    std::cout << "CHECKPOINT - Save run state (CHECKPOINT \"file\",n)\n";
     std::cout << "\nFunction Keys:\n";
     std::cout << "F1  - HELP\n";
     std::cout << "F2  - LIST\n";
@@ -96,38 +326,586 @@ void showVersion() {
 }
 
 void setVariable(const std::string& name, double value) {
-    for (size_t i = 0; i < variables.size(); i++) {
-        if (variables[i].name == name) {
-            variables[i].value = value;
+    for (size_t i = 0; i < vm->variables.size(); i++) {
+        if (vm->variables[i].name == name) {
+            vm->variables[i].value = value;
             return;
         }
     }
     Variable var;
     var.name = name;
     var.value = value;
-    variables.push_back(var);
+    vm->variables.push_back(var);
 }
 
 double getVariable(const std::string& name) {
-    for (size_t i = 0; i < variables.size(); i++) {
-        if (variables[i].name == name) {
-            return variables[i].value;
+    for (size_t i = 0; i < vm->variables.size(); i++) {
+        if (vm->variables[i].name == name) {
+            return vm->variables[i].value;
         }
     }
     return 0.0;
 }
 
+// Approximate bytes held by a machine's variables, arrays, strings and
+// file buffers
+size_t machineMemory(const Machine& m) {
+    size_t bytes = m.variables.size() * sizeof(Variable) +
+                   m.stringVars.size() * sizeof(StringVariable);
+    for (const auto& var : m.stringVars) {
+        bytes += var.value.capacity();
+    }
+    for (const auto& arr : m.arrays) {
+        bytes += arr.values.capacity() * sizeof(double);
+    }
+    for (const auto& channel : m.channels) {
+        bytes += sizeof(FileChannel) + channel.second->footprint();
+    }
+    return bytes;
+}
+
+// False when growing a machine by extra bytes would break its memory limit
+bool memoryAvailable(size_t extra) {
+    return vm->maxMemory == 0 || machineMemory(*vm) + extra <= vm->maxMemory;
+}
+
+void setStringVariable(const std::string& name, const std::string& value) {
+    for (auto& var : vm->stringVars) {
+        if (var.name == name) {
+            if (value.size() > var.value.capacity() &&
+                !memoryAvailable(value.size() - var.value.capacity())) {
+                *vm->out << "?OUT OF MEMORY\n";
+                return;
+            }
+            var.value = value;
+            return;
+        }
+    }
+    if (!memoryAvailable(sizeof(StringVariable) + value.size())) {
+        *vm->out << "?OUT OF MEMORY\n";
+        return;
+    }
+    vm->stringVars.push_back({name, value});
+}
+
+std::string getStringVariable(const std::string& name) {
+    for (const auto& var : vm->stringVars) {
+        if (var.name == name) {
+            return var.value;
+        }
+    }
+    return "";
+}
+
+Array* findArray(const std::string& name) {
+    for (auto& arr : vm->arrays) {
+        if (arr.name == name) return &arr;
+    }
+    return nullptr;
+}
+
+// Row-major element offset; DIM A(10) holds A(0) to A(10)
+size_t arrayOffset(const Array& arr, const double* indexes, size_t count) {
+    size_t offset = 0;
+    for (size_t i = 0; i < 3; i++) {
+        if ((i < count) != (arr.dimensions[i] >= 0)) {
+            throw std::runtime_error("?SUBSCRIPT OUT OF RANGE");
+        }
+        if (i == count) break;
+        double index = floor(indexes[i]);
+        if (index < 0 || index > arr.dimensions[i]) {
+            throw std::runtime_error("?SUBSCRIPT OUT OF RANGE");
+        }
+        offset = offset * (arr.dimensions[i] + 1) + static_cast<size_t>(index);
+    }
+    return offset;
+}
+
+// Small single-expression DEF FN bodies are copied into their call sites;
+// build with -DZUIX_INLINE_NODES=0 to turn that off when benchmarking
+#ifndef ZUIX_INLINE_NODES
+#define ZUIX_INLINE_NODES 16
+#endif
+const size_t maxInlineNodes = ZUIX_INLINE_NODES;
+const int maxFunctionDepth = 200;
+
+double builtinInt(double x) {
+    return floor(x);
+}
+
+struct Builtin {
+    const char* name;
+    double (*fn)(double);
+};
+
+const Builtin builtins[] = {
+    {"SIN", static_cast<double (*)(double)>(std::sin)},
+    {"COS", static_cast<double (*)(double)>(std::cos)},
+    {"TAN", static_cast<double (*)(double)>(std::tan)},
+    {"SQRT", static_cast<double (*)(double)>(std::sqrt)},
+    {"SQR", static_cast<double (*)(double)>(std::sqrt)},
+    {"LOG", static_cast<double (*)(double)>(std::log)},
+    {"EXP", static_cast<double (*)(double)>(std::exp)},
+    {"ABS", static_cast<double (*)(double)>(std::fabs)},
+    {"INT", builtinInt},
+};
+
+size_t countNodes(const Expr& e) {
+    size_t count = 1;
+    for (const auto& arg : e.args) {
+        count += countNodes(*arg);
+    }
+    return count;
+}
+
+size_t countParamUses(const Expr& e, int slot) {
+    size_t count = (e.kind == Expr::PARAM && e.slot == slot) ? 1 : 0;
+    for (const auto& arg : e.args) {
+        count += countParamUses(*arg, slot);
+    }
+    return count;
+}
+
+// Copy of body with every parameter slot replaced by its argument tree
+ExprPtr substituteParams(const ExprPtr& body, const std::vector<ExprPtr>& args) {
+    if (body->kind == Expr::PARAM) return args[body->slot];
+    ExprPtr copy = std::make_shared<Expr>(*body);
+    for (auto& arg : copy->args) {
+        arg = substituteParams(arg, args);
+    }
+    return copy;
+}
+
+// Recursive-descent parser: OR, AND, comparisons, + -, * /, unary -, ^
+class ExprParser {
+public:
+    ExprParser(const std::string& text, const std::vector<std::string>& params,
+               bool inlineCalls)
+        : text(text), params(params), inlineCalls(inlineCalls) {}
+
+    ExprPtr parse() {
+        ExprPtr e = parseOr();
+        skipSpaces();
+        if (pos != text.size()) throw std::runtime_error("?SYNTAX ERROR");
+        return e;
+    }
+
+private:
+    void skipSpaces() {
+        while (pos < text.size() && text[pos] == ' ') pos++;
+    }
+
+    bool match(const char* token) {
+        skipSpaces();
+        size_t len = strlen(token);
+        if (text.compare(pos, len, token) != 0) return false;
+        pos += len;
+        return true;
+    }
+
+    ExprPtr binary(char op, ExprPtr left, ExprPtr right) {
+        ExprPtr e = std::make_shared<Expr>();
+        e->kind = Expr::BINARY;
+        e->op = op;
+        e->args.push_back(left);
+        e->args.push_back(right);
+        return e;
+    }
+
+    ExprPtr parseOr() {
+        ExprPtr e = parseAnd();
+        while (match("OR")) e = binary('|', e, parseAnd());
+        return e;
+    }
+
+    ExprPtr parseAnd() {
+        ExprPtr e = parseCompare();
+        while (match("AND")) e = binary('&', e, parseCompare());
+        return e;
+    }
+
+    ExprPtr parseCompare() {
+        ExprPtr e = parseSum();
+        if (match("<=")) return binary('l', e, parseSum());
+        if (match(">=")) return binary('g', e, parseSum());
+        if (match("<>")) return binary('n', e, parseSum());
+        if (match("<")) return binary('<', e, parseSum());
+        if (match(">")) return binary('>', e, parseSum());
+        if (match("=")) return binary('=', e, parseSum());
+        return e;
+    }
+
+    ExprPtr parseSum() {
+        ExprPtr e = parseTerm();
+        while (true) {
+            if (match("+")) e = binary('+', e, parseTerm());
+            else if (match("-")) e = binary('-', e, parseTerm());
+            else return e;
+        }
+    }
+
+    ExprPtr parseTerm() {
+        ExprPtr e = parseUnary();
+        while (true) {
+            if (match("*")) e = binary('*', e, parseUnary());
+            else if (match("/")) e = binary('/', e, parseUnary());
+            else return e;
+        }
+    }
+
+    ExprPtr parseUnary() {
+        if (match("-")) {
+            ExprPtr e = std::make_shared<Expr>();
+            e->kind = Expr::NEGATE;
+            e->args.push_back(parseUnary());
+            return e;
+        }
+        match("+");
+        ExprPtr e = parsePrimary();
+        if (match("^")) e = binary('^', e, parseUnary());
+        return e;
+    }
+
+    std::vector<ExprPtr> parseArgs() {
+        std::vector<ExprPtr> args;
+        if (match(")")) return args;
+        do {
+            args.push_back(parseOr());
+        } while (match(","));
+        if (!match(")")) throw std::runtime_error("?SYNTAX ERROR");
+        return args;
+    }
+
+    ExprPtr parsePrimary() {
+        skipSpaces();
+        if (match("(")) {
+            ExprPtr e = parseOr();
+            if (!match(")")) throw std::runtime_error("?SYNTAX ERROR");
+            return e;
+        }
+        if (pos < text.size() && (isdigit(text[pos]) || text[pos] == '.')) {
+            size_t used;
+            ExprPtr e = std::make_shared<Expr>();
+            e->number = std::stod(text.substr(pos), &used);
+            pos += used;
+            return e;
+        }
+        if (pos >= text.size() || !isalpha(text[pos])) {
+            throw std::runtime_error("?SYNTAX ERROR");
+        }
+        size_t start = pos;
+        while (pos < text.size() && isalnum(text[pos])) pos++;
+        std::string name = text.substr(start, pos - start);
+
+        if (name.compare(0, 2, "FN") == 0 && match("(")) {
+            return parseCall(name, parseArgs());
+        }
+        if ((name == "EOF" || name == "LOF") && match("(")) {
+            ExprPtr e = std::make_shared<Expr>();
+            e->kind = Expr::FILE_FN;
+            e->name = name;
+            match("#");
+            e->args = parseArgs();
+            if (e->args.size() != 1) throw std::runtime_error("?SYNTAX ERROR");
+            return e;
+        }
+        if ((name == "MAX" || name == "MIN") && match("(")) {
+            std::vector<ExprPtr> args = parseArgs();
+            if (args.size() != 2) throw std::runtime_error("?SYNTAX ERROR");
+            return binary(name == "MAX" ? 'M' : 'm', args[0], args[1]);
+        }
+        for (const auto& builtin : builtins) {
+            if (name == builtin.name && match("(")) {
+                std::vector<ExprPtr> args = parseArgs();
+                if (args.size() != 1) throw std::runtime_error("?SYNTAX ERROR");
+                ExprPtr e = std::make_shared<Expr>();
+                e->kind = Expr::BUILTIN;
+                e->builtin = builtin.fn;
+                e->args = args;
+                return e;
+            }
+        }
+
+        ExprPtr e = std::make_shared<Expr>();
+        if (match("(")) {
+            e->kind = Expr::ARRAY;
+            e->name = name;
+            e->args = parseArgs();
+            if (e->args.empty() || e->args.size() > 3) {
+                throw std::runtime_error("?SYNTAX ERROR");
+            }
+            return e;
+        }
+        for (size_t i = 0; i < params.size(); i++) {
+            if (params[i] == name) {
+                e->kind = Expr::PARAM;
+                e->slot = static_cast<int>(i);
+                return e;
+            }
+        }
+        e->kind = Expr::VARIABLE;
+        e->name = name;
+        return e;
+    }
+
+    ExprPtr parseCall(const std::string& name, const std::vector<ExprPtr>& args) {
+        auto fn = vm->functions.find(name);
+        if (fn != vm->functions.end()) {
+            if (fn->second.params.size() != args.size()) {
+                throw std::runtime_error("?SYNTAX ERROR");
+            }
+            if (inlineCalls && canInline(fn->second, args)) {
+                return substituteParams(fn->second.body, args);
+            }
+        }
+        // Not defined yet (or too big): bind by name when evaluated
+        ExprPtr e = std::make_shared<Expr>();
+        e->kind = Expr::USER_FN;
+        e->name = name;
+        e->args = args;
+        return e;
+    }
+
+    // Inlining must not duplicate the work of a non-trivial argument
+    bool canInline(const UserFunction& fn, const std::vector<ExprPtr>& args) {
+        if (countNodes(*fn.body) > maxInlineNodes) return false;
+        for (size_t i = 0; i < args.size(); i++) {
+            bool leaf = args[i]->args.empty();
+            if (!leaf && countParamUses(*fn.body, static_cast<int>(i)) > 1) return false;
+        }
+        return true;
+    }
+
+    const std::string& text;
+    const std::vector<std::string>& params;
+    bool inlineCalls;
+    size_t pos = 0;
+};
+
+double applyOperator(char op, double a, double b) {
+    switch (op) {
+        case '+': return a + b;
+        case '-': return a - b;
+        case '*': return a * b;
+        case '/':
+            if (b == 0) throw std::runtime_error("?DIVISION BY ZERO");
+            return a / b;
+        case '^': return pow(a, b);
+        // Comparisons yield -1 for true, as in Microsoft BASIC
+        case '=': return a == b ? -1 : 0;
+        case '<': return a < b ? -1 : 0;
+        case '>': return a > b ? -1 : 0;
+        case 'l': return a <= b ? -1 : 0;
+        case 'g': return a >= b ? -1 : 0;
+        case 'n': return a != b ? -1 : 0;
+        case '&': return (a != 0 && b != 0) ? -1 : 0;
+        case '|': return (a != 0 || b != 0) ? -1 : 0;
+        case 'M': return a > b ? a : b;
+        case 'm': return a < b ? a : b;
+    }
+    return 0;
+}
+
+thread_local int functionDepth = 0;
+
+double evalExpr(const Expr& e, const double* frame) {
+    switch (e.kind) {
+        case Expr::NUMBER:
+            return e.number;
+        case Expr::VARIABLE:
+            return getVariable(e.name);
+        case Expr::PARAM:
+            return frame[e.slot];
+        case Expr::NEGATE:
+            return -evalExpr(*e.args[0], frame);
+        case Expr::BINARY:
+            return applyOperator(e.op, evalExpr(*e.args[0], frame),
+                                 evalExpr(*e.args[1], frame));
+        case Expr::BUILTIN:
+            return e.builtin(evalExpr(*e.args[0], frame));
+        case Expr::USER_FN: {
+            auto fn = vm->functions.find(e.name);
+            if (fn == vm->functions.end()) {
+                throw std::runtime_error("?UNDEFINED USER FUNCTION");
+            }
+            if (fn->second.params.size() != e.args.size()) {
+                throw std::runtime_error("?SYNTAX ERROR");
+            }
+            if (functionDepth >= maxFunctionDepth) {
+                throw std::runtime_error("?OUT OF MEMORY");
+            }
+            std::vector<double> args(e.args.size());
+            for (size_t i = 0; i < args.size(); i++) {
+                args[i] = evalExpr(*e.args[i], frame);
+            }
+            functionDepth++;
+            double result;
+            try {
+                result = evalExpr(*fn->second.body, args.data());
+            } catch (...) {
+                functionDepth--;
+                throw;
+            }
+            functionDepth--;
+            return result;
+        }
+        case Expr::ARRAY: {
+            const Array* arr = findArray(e.name);
+            if (!arr) throw std::runtime_error("?SUBSCRIPT OUT OF RANGE");
+            double indexes[3];
+            for (size_t i = 0; i < e.args.size(); i++) {
+                indexes[i] = evalExpr(*e.args[i], frame);
+            }
+            return arr->values[arrayOffset(*arr, indexes, e.args.size())];
+        }
+        case Expr::FILE_FN: {
+            double number = evalExpr(*e.args[0], frame);
+            auto channel = number >= 1 && number <= 255
+                               ? vm->channels.find(static_cast<int>(number))
+                               : vm->channels.end();
+            if (channel == vm->channels.end()) throw std::runtime_error("?BAD FILE NUMBER");
+            FileChannel& ch = *channel->second;
+            if (e.name == "LOF") return static_cast<double>(ch.size());
+            if (ch.mode == FileChannel::RANDOM) {
+                return (ch.nextRecord - 1) * ch.recordLength >= ch.size() ? -1 : 0;
+            }
+            return (ch.mode != FileChannel::INPUT || ch.atEnd()) ? -1 : 0;
+        }
+    }
+    return 0;
+}
+
+// Compile an expression once per machine; throws std::runtime_error
+const Expr& compileCached(const std::string& text) {
+    auto cached = vm->exprCache.find(text);
+    if (cached == vm->exprCache.end()) {
+        static const std::vector<std::string> noParams;
+        ExprPtr e = ExprParser(text, noParams, true).parse();
+        cached = vm->exprCache.emplace(text, e).first;
+    }
+    return *cached->second;
+}
+
+double evaluate(const std::string& text) {
+    return evalExpr(compileCached(text), nullptr);
+}
+
+// String expression: "literal" and NAME$ terms joined with +
+std::string evaluateString(const std::string& text) {
+    std::string result;
+    size_t pos = 0;
+    while (true) {
+        while (pos < text.size() && text[pos] == ' ') pos++;
+        if (pos < text.size() && text[pos] == '"') {
+            size_t close = text.find('"', pos + 1);
+            if (close == std::string::npos) throw std::runtime_error("?SYNTAX ERROR");
+            result += text.substr(pos + 1, close - pos - 1);
+            pos = close + 1;
+        } else {
+            size_t start = pos;
+            while (pos < text.size() && isalnum(text[pos])) pos++;
+            if (pos == start || pos >= text.size() || text[pos] != '$') {
+                throw std::runtime_error("?TYPE MISMATCH");
+            }
+            pos++;
+            result += getStringVariable(text.substr(start, pos - start));
+        }
+        if (!memoryAvailable(result.size())) throw std::runtime_error("?OUT OF MEMORY");
+        while (pos < text.size() && text[pos] == ' ') pos++;
+        if (pos == text.size()) return result;
+        if (text[pos++] != '+') throw std::runtime_error("?SYNTAX ERROR");
+    }
+}
+
+bool isStringExpression(const std::string& text) {
+    size_t first = text.find_first_not_of(' ');
+    size_t last = text.find_last_not_of(' ');
+    return first != std::string::npos &&
+           (text[first] == '"' || text[last] == '"' || text[last] == '$');
+}
+
+// Store into a variable or array element given as a target expression
+void assignTo(const Expr& target, double value) {
+    if (target.kind == Expr::VARIABLE) {
+        setVariable(target.name, value);
+    } else if (target.kind == Expr::ARRAY) {
+        Array* arr = findArray(target.name);
+        if (!arr) throw std::runtime_error("?SUBSCRIPT OUT OF RANGE");
+        double indexes[3];
+        for (size_t i = 0; i < target.args.size(); i++) {
+            indexes[i] = evalExpr(*target.args[i], nullptr);
+        }
+        arr->values[arrayOffset(*arr, indexes, target.args.size())] = value;
+    } else {
+        throw std::runtime_error("?SYNTAX ERROR");
+    }
+}
+
+// Format: DEF FNname(A,B) = expression
+void processDef(const std::string& cmd) {
+    size_t open = cmd.find('(');
+    size_t close = cmd.find(')');
+    size_t eq = cmd.find('=', close == std::string::npos ? 0 : close);
+    if (open == std::string::npos || close == std::string::npos ||
+        eq == std::string::npos || close < open) {
+        *vm->out << "?SYNTAX ERROR\n";
+        return;
+    }
+    std::string name = cmd.substr(4, open - 4);
+    name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+    if (name.compare(0, 2, "FN") != 0 || name.size() < 3) {
+        *vm->out << "?SYNTAX ERROR\n";
+        return;
+    }
+
+    UserFunction fn;
+    std::stringstream list(cmd.substr(open + 1, close - open - 1));
+    std::string param;
+    while (std::getline(list, param, ',')) {
+        param.erase(std::remove(param.begin(), param.end(), ' '), param.end());
+        if (!param.empty()) fn.params.push_back(param);
+    }
+    fn.source = cmd.substr(eq + 1);
+
+    auto existing = vm->functions.find(name);
+    if (existing != vm->functions.end() && existing->second.source == fn.source &&
+        existing->second.params == fn.params) {
+        return;  // Re-running the same DEF line
+    }
+    try {
+        // Calls inside a body stay late-bound so redefinitions are seen
+        fn.body = ExprParser(fn.source, fn.params, false).parse();
+    } catch (const std::runtime_error& e) {
+        *vm->out << e.what() << "\n";
+        return;
+    } catch (...) {
+        *vm->out << "?SYNTAX ERROR\n";
+        return;
+    }
+    vm->functions[name] = fn;
+    vm->exprCache.clear();  // Call sites may have inlined the old body
+}
+
 void processLet(const std::string& cmd) {
     size_t pos = cmd.find('=');
     if (pos != std::string::npos) {
         std::string varName = cmd.substr(4, pos-4);
         std::string valueStr = cmd.substr(pos+1);
+        varName.erase(std::remove(varName.begin(), varName.end(), ' '), varName.end());
         try {
-            double value = std::stod(valueStr);
-            setVariable(varName, value);
-            std::cout << "OK\n";
+            if (!varName.empty() && varName.back() == '$') {
+                setStringVariable(varName, evaluateString(valueStr));
+            } else {
+                double value = evaluate(valueStr);
+                assignTo(compileCached(varName), value);
+            }
+            if (!vm->isRunning) {
+                *vm->out << "OK\n";
+            }
+        } catch (const std::runtime_error& e) {
+            *vm->out << e.what() << "\n";
         } catch (...) {
-            std::cout << "?SYNTAX ERROR\n";
+            *vm->out << "?SYNTAX ERROR\n";
         }
     }
 }
@@ -153,35 +931,29 @@ std::string handleFunctionKey() {
     return std::string(1, (char)ch);
 }
 
-struct Line {
-    int number;
-    std::string content;
-};
-
-struct ForLoop {
-    std::string variable;
-    double start;
-    double end;
-    double step;
-    size_t returnLine;
-};
-
-std::vector<Line> program;
-std::vector<std::string> dataValues;
-size_t dataPointer = 0;
-std::vector<ForLoop> forLoops;
-
-void processInput(const std::string& cmd) {
+// Returns false when a non-interactive machine has no input queued yet,
+// or when Ctrl-C or SIGTERM interrupted the console read (the line is retried)
+bool processInput(const std::string& cmd) {
     std::string varName = cmd.substr(6);
-    std::cout << "? ";
     std::string value;
-    std::getline(std::cin, value);
+    if (vm->interactive) {
+        *vm->out << "? ";
+        if (!std::getline(std::cin, value) && (breakRequested || terminateRequested)) {
+            std::cin.clear();
+            return false;
+        }
+    } else {
+        if (vm->pendingInput.empty()) return false;
+        value = vm->pendingInput.front();
+        vm->pendingInput.pop_front();
+    }
     try {
         double numValue = std::stod(value);
         setVariable(varName, numValue);
     } catch (...) {
-        std::cout << "?REDO FROM START\n";
+        *vm->out << "?REDO FROM START\n";
     }
+    return true;
 }
 
 void processData(const std::string& cmd) {
@@ -190,23 +962,23 @@ void processData(const std::string& cmd) {
     size_t pos = 0;
     while ((pos = data.find(',')) != std::string::npos) {
         value = data.substr(0, pos);
-        dataValues.push_back(value);
+        vm->dataValues.push_back(value);
         data = data.substr(pos + 1);
     }
-    dataValues.push_back(data);
+    vm->dataValues.push_back(data);
 }
 
 void processRead(const std::string& cmd) {
     std::string varName = cmd.substr(5);
-    if (dataPointer >= dataValues.size()) {
-        std::cout << "?OUT OF DATA\n";
+    if (vm->dataPointer >= vm->dataValues.size()) {
+        *vm->out << "?OUT OF DATA\n";
         return;
     }
     try {
-        double value = std::stod(dataValues[dataPointer++]);
+        double value = std::stod(vm->dataValues[vm->dataPointer++]);
         setVariable(varName, value);
     } catch (...) {
-        std::cout << "?TYPE MISMATCH\n";
+        *vm->out << "?TYPE MISMATCH\n";
     }
 }
 
@@ -219,9 +991,12 @@ void addProgramLine(const std::string& line) {
         int lineNum = std::stoi(line.substr(0, spacePos));
         std::string content = line.substr(spacePos + 1);
         
+        // Editing the program invalidates any stopped run
+        vm->canContinue = false;
+        
         // Store or replace the line
         bool found = false;
-        for (auto& pLine : program) {
+        for (auto& pLine : vm->program) {
             if (pLine.number == lineNum) {
                 pLine.content = content;
                 found = true;
@@ -229,55 +1004,127 @@ void addProgramLine(const std::string& line) {
             }
         }
         if (!found) {
-            program.push_back({lineNum, content});
+            vm->program.push_back({lineNum, content});
             // Sort program by line numbers
-            std::sort(program.begin(), program.end(), 
+            std::sort(vm->program.begin(), vm->program.end(), 
                      [](const Line& a, const Line& b) { return a.number < b.number; });
         }
-        std::cout << "OK\n";
+        *vm->out << "OK\n";
     } catch (...) {
-        std::cout << "?SYNTAX ERROR\n";
+        *vm->out << "?SYNTAX ERROR\n";
+    }
+}
+
+// Split on commas/semicolons outside quotes and parentheses, keeping separators
+std::vector<std::string> splitItems(const std::string& text, std::vector<char>* separators) {
+    std::vector<std::string> items;
+    std::string item;
+    int depth = 0;
+    bool quoted = false;
+    for (char c : text) {
+        if (c == '"') quoted = !quoted;
+        if (!quoted && c == '(') depth++;
+        if (!quoted && c == ')') depth--;
+        if (!quoted && depth == 0 && (c == ',' || c == ';')) {
+            items.push_back(item);
+            if (separators) separators->push_back(c);
+            item.clear();
+        } else {
+            item += c;
+        }
     }
+    items.push_back(item);
+    return items;
 }
 
 void processPrint(const std::string& cmd) {
     std::string content = cmd.substr(6);
     if (content.empty()) {
-        std::cout << "\n";
+        *vm->out << "\n";
         return;
     }
     
-    if (content[0] == '"') {
+    size_t endQuote = content[0] == '"' ? content.find('"', 1) : std::string::npos;
+    if (endQuote != std::string::npos &&
+        content.find_first_not_of(' ', endQuote + 1) == std::string::npos) {
         // Print string literal
-        size_t endQuote = content.find('"', 1);
-        if (endQuote != std::string::npos) {
-            std::cout << content.substr(1, endQuote - 1) << "\n";
-        }
-    } else {
-        // Check if it's a variable
-        try {
-            double value = getVariable(content);
-            std::cout << value << "\n";
-        } catch (...) {
-            // If not a variable, print as literal text
-            std::cout << content << "\n";
-        }
+        *vm->out << content.substr(1, endQuote - 1) << "\n";
+        return;
+    }
+    // Items joined by ";"; "," moves to the next 14-column print zone
+    std::vector<char> separators;
+    std::vector<std::string> items = splitItems(content, &separators);
+    std::ostringstream line;
+    try {
+        for (size_t i = 0; i < items.size(); i++) {
+            if (items[i].find_first_not_of(' ') != std::string::npos) {
+                if (isStringExpression(items[i])) {
+                    line << evaluateString(items[i]);
+                } else {
+                    line << evaluate(items[i]);
+                }
+            }
+            if (i < separators.size() && separators[i] == ',') {
+                size_t column = static_cast<size_t>(line.tellp());
+                line << std::string(14 - column % 14, ' ');
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        *vm->out << e.what() << "\n";
+        return;
+    } catch (...) {
+        // If not a variable, print as literal text
+        *vm->out << content << "\n";
+        return;
     }
+    // A trailing separator suppresses the newline
+    if (separators.empty() || items.back().find_first_not_of(' ') != std::string::npos) {
+        line << '\n';
+    }
+    *vm->out << line.str();
 }
 
-// Add these to the existing global variables
-int currentLine = 0;
-bool isRunning = false;
+// Index of a line number in the (sorted) program, -1 if missing
+int findLine(int lineNumber) {
+    auto it = std::lower_bound(vm->program.begin(), vm->program.end(), lineNumber,
+                               [](const Line& line, int number) { return line.number < number; });
+    if (it == vm->program.end() || it->number != lineNumber) return -1;
+    return static_cast<int>(it - vm->program.begin());
+}
 
 // Add this function for GOTO handling
 void gotoLine(int lineNumber) {
-    for (size_t i = 0; i < program.size(); i++) {
-        if (program[i].number == lineNumber) {
-            currentLine = i;
-            return;
+    int index = findLine(lineNumber);
+    if (index >= 0) {
+        vm->currentLine = index;
+        return;
+    }
+    *vm->out << "?UNDEFINED LINE NUMBER\n";
+}
+
+// Look up every GOTO, GOSUB and IF ... THEN target once before running
+void resolveJumps() {
+    vm->lineTargets.assign(vm->program.size(), -1);
+    for (size_t i = 0; i < vm->program.size(); i++) {
+        const std::string& cmd = vm->program[i].content;
+        size_t target = std::string::npos;
+        if (cmd.substr(0, 5) == "GOTO ") target = 5;
+        else if (cmd.substr(0, 6) == "GOSUB ") target = 6;
+        else if (cmd.substr(0, 3) == "IF ") {
+            target = cmd.find("THEN");
+            if (target != std::string::npos) target += 4;
+        }
+        if (target == std::string::npos) continue;
+        std::string number = cmd.substr(target);
+        number.erase(std::remove(number.begin(), number.end(), ' '), number.end());
+        if (number.substr(0, 4) == "GOTO") number = number.substr(4);
+        if (number.substr(0, 5) == "GOSUB") number = number.substr(5);
+        try {
+            vm->lineTargets[i] = findLine(std::stoi(number));
+        } catch (...) {
+            // Left as -1, reported when the line runs
         }
     }
-    std::cout << "?UNDEFINED LINE NUMBER\n";
 }
 
 // Add FOR loop handling
@@ -286,7 +1133,7 @@ void processFor(const std::string& cmd) {
     size_t eqPos = cmd.find('=');
     size_t toPos = cmd.find("TO");
     if (eqPos == std::string::npos || toPos == std::string::npos) {
-        std::cout << "?SYNTAX ERROR\n";
+        *vm->out << "?SYNTAX ERROR\n";
         return;
     }
 
@@ -294,15 +1141,15 @@ void processFor(const std::string& cmd) {
     var = std::string(var.begin(), std::remove(var.begin(), var.end(), ' '));
     
     try {
-        double start = std::stod(cmd.substr(eqPos + 1, toPos - eqPos - 1));
+        double start = evaluate(cmd.substr(eqPos + 1, toPos - eqPos - 1));
         size_t stepPos = cmd.find("STEP");
         double end, step = 1;
         
         if (stepPos != std::string::npos) {
-            end = std::stod(cmd.substr(toPos + 2, stepPos - toPos - 2));
-            step = std::stod(cmd.substr(stepPos + 4));
+            end = evaluate(cmd.substr(toPos + 2, stepPos - toPos - 2));
+            step = evaluate(cmd.substr(stepPos + 4));
         } else {
-            end = std::stod(cmd.substr(toPos + 2));
+            end = evaluate(cmd.substr(toPos + 2));
         }
 
         setVariable(var, start);
@@ -311,103 +1158,89 @@ void processFor(const std::string& cmd) {
         loop.start = start;
         loop.end = end;
         loop.step = step;
-        loop.returnLine = static_cast<size_t>(currentLine);
-        forLoops.push_back(loop);
+        loop.returnLine = static_cast<size_t>(vm->currentLine);
+        vm->forLoops.push_back(loop);
         
+    } catch (const std::runtime_error& e) {
+        *vm->out << e.what() << "\n";
     } catch (...) {
-        std::cout << "?SYNTAX ERROR\n";
+        *vm->out << "?SYNTAX ERROR\n";
     }
 }
 
 // Add NEXT handling
 void processNext(const std::string& cmd) {
-    if (forLoops.empty()) {
-        std::cout << "?NEXT WITHOUT FOR\n";
+    if (vm->forLoops.empty()) {
+        *vm->out << "?NEXT WITHOUT FOR\n";
         return;
     }
 
-    ForLoop& loop = forLoops.back();
+    ForLoop& loop = vm->forLoops.back();
     double currentVal = getVariable(loop.variable);
     currentVal += loop.step;
     
     if ((loop.step > 0 && currentVal <= loop.end) || 
         (loop.step < 0 && currentVal >= loop.end)) {
         setVariable(loop.variable, currentVal);
-        currentLine = loop.returnLine;
+        vm->currentLine = loop.returnLine + 1;  // First line of the loop body
     } else {
-        forLoops.pop_back();
+        vm->forLoops.pop_back();
+        vm->currentLine++;
     }
 }
 
-// Add these new structures and globals
-struct StringVariable {
-    std::string name;
-    std::string value;
-};
-
-struct Array {
-    std::string name;
-    std::vector<double> values;
-    int dimensions[3];  // Support up to 3D arrays
-};
-
-std::vector<StringVariable> stringVars;
-std::vector<Array> arrays;
-std::vector<size_t> gosubStack;  // For GOSUB/RETURN
-
-// Add these new functions
-void setStringVariable(const std::string& name, const std::string& value) {
-    for (auto& var : stringVars) {
-        if (var.name == name) {
-            var.value = value;
-            return;
-        }
-    }
-    stringVars.push_back({name, value});
-}
-
-std::string getStringVariable(const std::string& name) {
-    for (const auto& var : stringVars) {
-        if (var.name == name) {
-            return var.value;
-        }
-    }
-    return "";
-}
-
 // Add array handling
 void dimArray(const std::string& cmd) {
     // Format: DIM A(10) or DIM B(5,5)
     size_t start = cmd.find('(');
     size_t end = cmd.find(')');
     if (start == std::string::npos || end == std::string::npos) {
-        std::cout << "?SYNTAX ERROR\n";
+        *vm->out << "?SYNTAX ERROR\n";
         return;
     }
     
     std::string name = cmd.substr(4, start-4);
+    name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
     std::string dims = cmd.substr(start+1, end-start-1);
+    if (findArray(name)) {
+        *vm->out << "?REDIMENSIONED ARRAY\n";
+        return;
+    }
     
     Array arr;
     arr.name = name;
+    arr.dimensions[0] = arr.dimensions[1] = arr.dimensions[2] = -1;
     
     // Parse dimensions
     int dimCount = 0;
     size_t pos = 0;
-    while ((pos = dims.find(',')) != std::string::npos) {
-        arr.dimensions[dimCount++] = std::stoi(dims.substr(0, pos));
-        dims = dims.substr(pos + 1);
+    try {
+        while ((pos = dims.find(',')) != std::string::npos && dimCount < 2) {
+            arr.dimensions[dimCount++] = static_cast<int>(evaluate(dims.substr(0, pos)));
+            dims = dims.substr(pos + 1);
+        }
+        arr.dimensions[dimCount++] = static_cast<int>(evaluate(dims));
+    } catch (...) {
+        *vm->out << "?SYNTAX ERROR\n";
+        return;
     }
-    arr.dimensions[dimCount++] = std::stoi(dims);
     
-    // Calculate total size
-    int totalSize = 1;
+    // Calculate total size, each dimension runs from 0 to its bound
+    size_t totalSize = 1;
     for (int i = 0; i < dimCount; i++) {
-        totalSize *= arr.dimensions[i];
+        if (arr.dimensions[i] < 0) {
+            *vm->out << "?ILLEGAL FUNCTION CALL\n";
+            return;
+        }
+        totalSize *= static_cast<size_t>(arr.dimensions[i]) + 1;
     }
     
+    if (!memoryAvailable(totalSize * sizeof(double))) {
+        *vm->out << "?OUT OF MEMORY\n";
+        return;
+    }
     arr.values.resize(totalSize);
-    arrays.push_back(arr);
+    vm->arrays.push_back(arr);
 }
 
 // Add math functions
@@ -444,48 +1277,394 @@ std::string midStr(const std::string& str, int start, int len) {
 void saveProgram(const std::string& filename) {
     std::ofstream file(filename);
     if (!file) {
-        std::cout << "?CANNOT OPEN FILE\n";
+        *vm->out << "?CANNOT OPEN FILE\n";
         return;
     }
-    for (const auto& line : program) {
+    for (const auto& line : vm->program) {
         file << line.number << " " << line.content << "\n";
     }
-    std::cout << "OK\n";
+    *vm->out << "OK\n";
 }
 
 void loadProgram(const std::string& filename) {
     std::ifstream file(filename);
     if (!file) {
-        std::cout << "?FILE NOT FOUND\n";
+        *vm->out << "?FILE NOT FOUND\n";
         return;
     }
-    program.clear();
+    vm->program.clear();
     std::string line;
     while (std::getline(file, line)) {
         addProgramLine(line);
     }
-    std::cout << "OK\n";
+    resolveJumps();
+    *vm->out << "OK\n";
+}
+
+// Data file channels: OPEN, CLOSE, PRINT #, INPUT #, LINE INPUT #, FIELD, GET, PUT
+
+// Parse "#n" at pos (the # is optional) and return the open channel
+FileChannel* channelAt(const std::string& text, size_t& pos) {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '#')) pos++;
+    size_t start = pos;
+    while (pos < text.size() && isdigit(text[pos])) pos++;
+    auto channel = vm->channels.end();
+    if (pos > start && pos - start <= 3) {
+        channel = vm->channels.find(std::atoi(text.substr(start, pos - start).c_str()));
+    }
+    if (channel == vm->channels.end()) {
+        *vm->out << "?BAD FILE NUMBER\n";
+        return nullptr;
+    }
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == ',')) pos++;
+    return channel->second.get();
+}
+
+// Format: OPEN "file" FOR INPUT|OUTPUT|APPEND|RANDOM AS #n [LEN=bytes]
+void processOpen(const std::string& cmd) {
+    size_t open = cmd.find('"');
+    size_t close = cmd.find('"', open + 1);
+    size_t forPos = cmd.find(" FOR ", close);
+    size_t asPos = cmd.find(" AS ", forPos);
+    if (open == std::string::npos || close == std::string::npos ||
+        forPos == std::string::npos || asPos == std::string::npos) {
+        *vm->out << "?SYNTAX ERROR\n";
+        return;
+    }
+    std::string filename = cmd.substr(open + 1, close - open - 1);
+    std::string mode = cmd.substr(forPos + 5, asPos - forPos - 5);
+    mode.erase(std::remove(mode.begin(), mode.end(), ' '), mode.end());
+
+    std::unique_ptr<FileChannel> channel(new FileChannel());
+    int number;
+    try {
+        std::string rest = cmd.substr(asPos + 4);
+        size_t lenPos = rest.find("LEN");
+        size_t hash = rest.find('#');
+        number = std::stoi(rest.substr(hash == std::string::npos ? 0 : hash + 1));
+        if (lenPos != std::string::npos) {
+            channel->recordLength = static_cast<size_t>(
+                std::stoul(rest.substr(rest.find('=', lenPos) + 1)));
+        }
+    } catch (...) {
+        *vm->out << "?SYNTAX ERROR\n";
+        return;
+    }
+    if (number < 1 || number > 255) {
+        *vm->out << "?BAD FILE NUMBER\n";
+        return;
+    }
+    if (channel->recordLength == 0 || channel->recordLength > FileChannel::maxRecordLength) {
+        *vm->out << "?BAD RECORD LENGTH\n";
+        return;
+    }
+    if (vm->channels.count(number)) {
+        *vm->out << "?FILE ALREADY OPEN\n";
+        return;
+    }
+
+    if (mode == "INPUT") {
+        channel->mode = FileChannel::INPUT;
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd >= 0 && fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+                channel->mapping = mapping;
+                channel->length = static_cast<size_t>(info.st_size);
+                channel->cur = static_cast<const char*>(mapping);
+                channel->end = channel->cur + channel->length;
+            }
+        }
+        if (fd >= 0) ::close(fd);
+#endif
+        if (!channel->mapping) {
+            channel->file = fopen(filename.c_str(), "rb");
+            if (channel->file) {
+                fseek(channel->file, 0, SEEK_END);
+                long total = ftell(channel->file);
+                channel->length = total < 0 ? 0 : static_cast<size_t>(total);
+                fseek(channel->file, 0, SEEK_SET);
+            }
+        }
+        if (!channel->mapping && !channel->file) {
+            *vm->out << "?FILE NOT FOUND\n";
+            return;
+        }
+        if (!channel->mapping) {
+            if (!memoryAvailable(FileChannel::bufferSize)) {
+                *vm->out << "?OUT OF MEMORY\n";
+                return;
+            }
+            channel->window.reserve(FileChannel::bufferSize);
+        }
+    } else if (mode == "OUTPUT" || mode == "APPEND") {
+        channel->mode = mode == "OUTPUT" ? FileChannel::OUTPUT : FileChannel::APPEND;
+        if (!memoryAvailable(FileChannel::bufferSize)) {
+            *vm->out << "?OUT OF MEMORY\n";
+            return;
+        }
+        channel->file = fopen(filename.c_str(), mode == "OUTPUT" ? "wb" : "ab");
+        if (!channel->file) {
+            *vm->out << "?CANNOT OPEN FILE\n";
+            return;
+        }
+        // Owned by the channel so it is counted, and so stdio keeps its size
+        channel->buffer.resize(FileChannel::bufferSize);
+        setvbuf(channel->file, channel->buffer.data(), _IOFBF, channel->buffer.size());
+    } else if (mode == "RANDOM") {
+        channel->mode = FileChannel::RANDOM;
+        if (!memoryAvailable(channel->recordLength)) {
+            *vm->out << "?OUT OF MEMORY\n";
+            return;
+        }
+        channel->file = fopen(filename.c_str(), "r+b");
+        if (!channel->file) channel->file = fopen(filename.c_str(), "w+b");
+        if (!channel->file) {
+            *vm->out << "?CANNOT OPEN FILE\n";
+            return;
+        }
+        channel->record.assign(channel->recordLength, ' ');
+    } else {
+        *vm->out << "?SYNTAX ERROR\n";
+        return;
+    }
+    vm->channels[number] = std::move(channel);
+}
+
+// Format: CLOSE [#n[,#m...]] - no numbers closes every channel
+void processClose(const std::string& cmd) {
+    std::string list = cmd.substr(5);
+    if (list.find_first_not_of(' ') == std::string::npos) {
+        vm->channels.clear();
+        return;
+    }
+    for (auto item : splitItems(list, nullptr)) {
+        item.erase(std::remove(item.begin(), item.end(), '#'), item.end());
+        try {
+            if (vm->channels.erase(std::stoi(item)) == 0) {
+                *vm->out << "?BAD FILE NUMBER\n";
+            }
+        } catch (...) {
+            *vm->out << "?SYNTAX ERROR\n";
+        }
+    }
+}
+
+// Format: PRINT #n, item[;item][,item] - ";" joins, "," writes a comma (CSV)
+void processPrintFile(const std::string& cmd) {
+    size_t pos = 6;
+    FileChannel* channel = channelAt(cmd, pos);
+    if (!channel) return;
+    if (channel->mode != FileChannel::OUTPUT && channel->mode != FileChannel::APPEND) {
+        *vm->out << "?BAD FILE MODE\n";
+        return;
+    }
+    std::vector<char> separators;
+    std::vector<std::string> items = splitItems(cmd.substr(pos), &separators);
+    std::string line;
+    try {
+        for (size_t i = 0; i < items.size(); i++) {
+            if (items[i].find_first_not_of(' ') != std::string::npos) {
+                if (isStringExpression(items[i])) {
+                    line += evaluateString(items[i]);
+                } else {
+                    // Full precision so data survives a write/read round trip
+                    char number[32];
+                    snprintf(number, sizeof(number), "%.15g", evaluate(items[i]));
+                    line += number;
+                }
+            }
+            if (i < separators.size() && separators[i] == ',') line += ',';
+        }
+    } catch (const std::runtime_error& e) {
+        *vm->out << e.what() << "\n";
+        return;
+    } catch (...) {
+        *vm->out << "?SYNTAX ERROR\n";
+        return;
+    }
+    // A trailing separator suppresses the newline, as with PRINT
+    if (separators.empty() || items.back().find_first_not_of(' ') != std::string::npos) {
+        line += '\n';
+    }
+    fwrite(line.data(), 1, line.size(), channel->file);
+}
+
+// Format: INPUT #n, A, B$ - comma or newline separated values
+void processInputFile(const std::string& cmd) {
+    size_t pos = 6;
+    FileChannel* channel = channelAt(cmd, pos);
+    if (!channel) return;
+    if (channel->mode != FileChannel::INPUT) {
+        *vm->out << "?BAD FILE MODE\n";
+        return;
+    }
+    std::string field;
+    for (auto name : splitItems(cmd.substr(pos), nullptr)) {
+        name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+        if (!channel->readField(field)) {
+            *vm->out << "?INPUT PAST END\n";
+            return;
+        }
+        try {
+            if (!name.empty() && name.back() == '$') {
+                setStringVariable(name, field);
+            } else {
+                assignTo(compileCached(name), field.empty() ? 0 : std::stod(field));
+            }
+        } catch (const std::runtime_error& e) {
+            *vm->out << e.what() << "\n";
+            return;
+        } catch (...) {
+            *vm->out << "?TYPE MISMATCH\n";
+            return;
+        }
+    }
+}
+
+// Format: LINE INPUT #n, A$ - the whole next line
+void processLineInputFile(const std::string& cmd) {
+    size_t pos = 11;
+    FileChannel* channel = channelAt(cmd, pos);
+    if (!channel) return;
+    if (channel->mode != FileChannel::INPUT) {
+        *vm->out << "?BAD FILE MODE\n";
+        return;
+    }
+    std::string name = cmd.substr(pos);
+    name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+    if (name.empty() || name.back() != '$') {
+        *vm->out << "?TYPE MISMATCH\n";
+        return;
+    }
+    std::string line;
+    if (!channel->readLine(line)) {
+        *vm->out << "?INPUT PAST END\n";
+        return;
+    }
+    setStringVariable(name, line);
+}
+
+// Format: FIELD #n, 10 AS A$, 20 AS B$ - lays string variables over a record
+void processField(const std::string& cmd) {
+    size_t pos = 6;
+    FileChannel* channel = channelAt(cmd, pos);
+    if (!channel) return;
+    if (channel->mode != FileChannel::RANDOM) {
+        *vm->out << "?BAD FILE MODE\n";
+        return;
+    }
+    std::vector<std::pair<std::string, size_t>> fields;
+    size_t total = 0;
+    for (const auto& item : splitItems(cmd.substr(pos), nullptr)) {
+        size_t asPos = item.find(" AS ");
+        if (asPos == std::string::npos) {
+            *vm->out << "?SYNTAX ERROR\n";
+            return;
+        }
+        std::string name = item.substr(asPos + 4);
+        name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+        double width;
+        try {
+            width = evaluate(item.substr(0, asPos));
+        } catch (...) {
+            *vm->out << "?SYNTAX ERROR\n";
+            return;
+        }
+        if (!(width >= 0 && width <= channel->recordLength)) {
+            *vm->out << "?FIELD OVERFLOW\n";
+            return;
+        }
+        fields.push_back(std::make_pair(name, static_cast<size_t>(width)));
+        total += static_cast<size_t>(width);
+    }
+    if (total > channel->recordLength) {
+        *vm->out << "?FIELD OVERFLOW\n";
+        return;
+    }
+    channel->fields = fields;
+}
+
+// Format: GET #n[,record] / PUT #n[,record] - records count from 1.
+// PUT writes the FIELD variables' current values, space padded.
+void processGetPut(const std::string& cmd, bool put) {
+    size_t pos = 4;
+    FileChannel* channel = channelAt(cmd, pos);
+    if (!channel) return;
+    if (channel->mode != FileChannel::RANDOM) {
+        *vm->out << "?BAD FILE MODE\n";
+        return;
+    }
+    size_t recordNumber = channel->nextRecord;
+    if (cmd.find_first_not_of(' ', pos) != std::string::npos) {
+        try {
+            double value = evaluate(cmd.substr(pos));
+            // Keep the byte offset within what fseek can address
+            double lastRecord = static_cast<double>(LONG_MAX / channel->recordLength);
+            if (!(value >= 1 && value <= lastRecord)) {
+                throw std::runtime_error("?BAD RECORD NUMBER");
+            }
+            recordNumber = static_cast<size_t>(value);
+        } catch (const std::runtime_error& e) {
+            *vm->out << e.what() << "\n";
+            return;
+        } catch (...) {
+            *vm->out << "?SYNTAX ERROR\n";
+            return;
+        }
+    }
+    if (fseek(channel->file, static_cast<long>((recordNumber - 1) * channel->recordLength),
+              SEEK_SET) != 0) {
+        *vm->out << "?BAD RECORD NUMBER\n";
+        return;
+    }
+
+    std::vector<char>& record = channel->record;
+    if (put) {
+        size_t offset = 0;
+        for (const auto& field : channel->fields) {
+            std::string value = getStringVariable(field.first);
+            value.resize(field.second, ' ');
+            std::copy(value.begin(), value.end(), record.begin() + offset);
+            offset += field.second;
+        }
+        fwrite(record.data(), 1, record.size(), channel->file);
+    } else {
+        size_t got = fread(record.data(), 1, record.size(), channel->file);
+        std::fill(record.begin() + got, record.end(), ' ');
+        size_t offset = 0;
+        for (const auto& field : channel->fields) {
+            setStringVariable(field.first,
+                              std::string(record.begin() + offset,
+                                          record.begin() + offset + field.second));
+            offset += field.second;
+        }
+    }
+    channel->nextRecord = recordNumber + 1;
 }
 
 // Add graphics commands (using ASCII art for now)
 void drawLine(int x1, int y1, int x2, int y2) {
     // Simple ASCII line drawing
-    std::cout << "Drawing line from (" << x1 << "," << y1 
+    *vm->out << "Drawing line from (" << x1 << "," << y1 
               << ") to (" << x2 << "," << y2 << ")\n";
-    std::cout << "*****\n";
+    *vm->out << "*****\n";
 }
 
 void drawCircle(int x, int y, int radius) {
-    std::cout << "Drawing circle at (" << x << "," << y 
+    *vm->out << "Drawing circle at (" << x << "," << y 
               << ") with radius " << radius << "\n";
-    std::cout << " *** \n";
-    std::cout << "*   *\n";
-    std::cout << " *** \n";
+    *vm->out << " *** \n";
+    *vm->out << "*   *\n";
+    *vm->out << " *** \n";
 }
 
 // Add sound functions
 void playSound(int frequency, int duration) {
-    std::cout << "\a"; // Simple beep for now
+    *vm->out << "\a"; // Simple beep for now
     std::this_thread::sleep_for(std::chrono::milliseconds(duration));
 }
 
@@ -517,74 +1696,968 @@ double evalAdvancedMath(const std::string& cmd) {
     return evalMathFunction(cmd); // Call original math functions
 }
 
-// Modify runProgram to include new commands
-void runProgram() {
-    if (program.empty()) {
-        std::cout << "NO PROGRAM\n";
-        return;
+// Interruption (Ctrl-C / STOP) and CONT support
+void handleBreakSignal(int) {
+    breakRequested = 1;
+}
+
+void handleTerminateSignal(int) {
+    terminateRequested = 1;
+}
+
+
+// Checkpoint files: a binary snapshot of the program and its run state.
+// Layout (host byte order, strings are u32 length + bytes):
+//   "ZXCK" u32 version, u32 currentLine, u32 dataPointer,
+//   checkpoint file name, u32 checkpoint interval,
+//   program, variables, string variables, arrays (dims + raw doubles),
+//   FOR loops, GOSUB stack, DATA values, DEF FN functions (name, params,
+//   body text) - each as u32 count + entries.
+const char checkpointMagic[4] = {'Z', 'X', 'C', 'K'};
+const uint32_t checkpointVersion = 3;
+
+void writeU32(std::ostream& out, uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeDouble(std::ostream& out, double value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeString(std::ostream& out, const std::string& str) {
+    writeU32(out, static_cast<uint32_t>(str.size()));
+    out.write(str.data(), str.size());
+}
+
+bool readU32(std::istream& in, uint32_t& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+bool readDouble(std::istream& in, double& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+bool readString(std::istream& in, std::string& str) {
+    uint32_t len;
+    if (!readU32(in, len)) return false;
+    str.resize(len);
+    return len == 0 || static_cast<bool>(in.read(&str[0], len));
+}
+
+bool writeCheckpoint(const std::string& filename, size_t resumeLine) {
+    // Write to a temporary file first so a crash never leaves a torn snapshot
+    std::string tmpName = filename + ".TMP";
+    {
+        std::ofstream file(tmpName, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            *vm->out << "?CANNOT OPEN FILE\n";
+            return false;
+        }
+        file.write(checkpointMagic, sizeof(checkpointMagic));
+        writeU32(file, checkpointVersion);
+        writeU32(file, static_cast<uint32_t>(resumeLine));
+        writeU32(file, static_cast<uint32_t>(vm->dataPointer));
+        writeString(file, vm->checkpointFile);
+        writeU32(file, static_cast<uint32_t>(vm->checkpointInterval));
+
+        writeU32(file, static_cast<uint32_t>(vm->program.size()));
+        for (const auto& line : vm->program) {
+            writeU32(file, static_cast<uint32_t>(line.number));
+            writeString(file, line.content);
+        }
+        writeU32(file, static_cast<uint32_t>(vm->variables.size()));
+        for (const auto& var : vm->variables) {
+            writeString(file, var.name);
+            writeDouble(file, var.value);
+        }
+        writeU32(file, static_cast<uint32_t>(vm->stringVars.size()));
+        for (const auto& var : vm->stringVars) {
+            writeString(file, var.name);
+            writeString(file, var.value);
+        }
+        writeU32(file, static_cast<uint32_t>(vm->arrays.size()));
+        for (const auto& arr : vm->arrays) {
+            writeString(file, arr.name);
+            for (int i = 0; i < 3; i++) {
+                writeU32(file, static_cast<uint32_t>(arr.dimensions[i]));
+            }
+            writeU32(file, static_cast<uint32_t>(arr.values.size()));
+            file.write(reinterpret_cast<const char*>(arr.values.data()),
+                       arr.values.size() * sizeof(double));
+        }
+        writeU32(file, static_cast<uint32_t>(vm->forLoops.size()));
+        for (const auto& loop : vm->forLoops) {
+            writeString(file, loop.variable);
+            writeDouble(file, loop.start);
+            writeDouble(file, loop.end);
+            writeDouble(file, loop.step);
+            writeU32(file, static_cast<uint32_t>(loop.returnLine));
+        }
+        writeU32(file, static_cast<uint32_t>(vm->gosubDepth));
+        for (size_t i = 0; i < vm->gosubDepth; i++) {
+            writeU32(file, static_cast<uint32_t>(vm->gosubStack[i]));
+        }
+        writeU32(file, static_cast<uint32_t>(vm->dataValues.size()));
+        for (const auto& value : vm->dataValues) {
+            writeString(file, value);
+        }
+        writeU32(file, static_cast<uint32_t>(vm->functions.size()));
+        for (const auto& fn : vm->functions) {
+            writeString(file, fn.first);
+            writeU32(file, static_cast<uint32_t>(fn.second.params.size()));
+            for (const auto& param : fn.second.params) {
+                writeString(file, param);
+            }
+            writeString(file, fn.second.source);
+        }
+        if (!file.flush()) {
+            *vm->out << "?DISK FULL\n";
+            return false;
+        }
+    }
+    if (std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+        *vm->out << "?CANNOT OPEN FILE\n";
+        return false;
     }
+    return true;
+}
 
-    isRunning = true;
-    currentLine = 0;
-    forLoops.clear();
+bool readCheckpoint(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        *vm->out << "?FILE NOT FOUND\n";
+        return false;
+    }
+    char magic[4];
+    uint32_t version, resumeLine, pointer, interval, count;
+    std::string target;
+    if (!file.read(magic, sizeof(magic)) ||
+        !std::equal(magic, magic + 4, checkpointMagic) ||
+        !readU32(file, version) || version != checkpointVersion ||
+        !readU32(file, resumeLine) || !readU32(file, pointer) ||
+        !readString(file, target) || !readU32(file, interval)) {
+        *vm->out << "?BAD FILE FORMAT\n";
+        return false;
+    }
 
-    while (currentLine < program.size() && isRunning) {
-        std::string cmd = program[currentLine].content;
-        
-        if (cmd.substr(0, 6) == "PRINT ") {
-            processPrint(cmd);
+    // Restore into locals so a truncated file leaves the current state alone
+    std::vector<Line> newProgram;
+    std::vector<Variable> newVariables;
+    std::vector<StringVariable> newStringVars;
+    std::vector<Array> newArrays;
+    std::vector<ForLoop> newForLoops;
+    std::vector<size_t> newGosubStack;
+    std::vector<std::string> newDataValues;
+    std::map<std::string, UserFunction> newFunctions;
+    bool ok = readU32(file, count);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        Line line;
+        uint32_t number;
+        ok = readU32(file, number) && readString(file, line.content);
+        line.number = static_cast<int>(number);
+        newProgram.push_back(line);
+    }
+    ok = ok && readU32(file, count);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        Variable var = Variable();
+        ok = readString(file, var.name) && readDouble(file, var.value);
+        newVariables.push_back(var);
+    }
+    ok = ok && readU32(file, count);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        StringVariable var;
+        ok = readString(file, var.name) && readString(file, var.value);
+        newStringVars.push_back(var);
+    }
+    ok = ok && readU32(file, count);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        Array arr;
+        uint32_t dim, size;
+        ok = readString(file, arr.name);
+        for (int d = 0; ok && d < 3; d++) {
+            ok = readU32(file, dim);
+            arr.dimensions[d] = static_cast<int>(dim);
         }
-        else if (cmd.substr(0, 4) == "LET ") {
-            processLet(cmd);
+        ok = ok && readU32(file, size);
+        if (ok) {
+            arr.values.resize(size);
+            ok = size == 0 || static_cast<bool>(file.read(
+                reinterpret_cast<char*>(arr.values.data()), size * sizeof(double)));
         }
-        else if (cmd.substr(0, 5) == "GOTO ") {
-            try {
-                int lineNum = std::stoi(cmd.substr(5));
-                gotoLine(lineNum);
+        newArrays.push_back(arr);
+    }
+    ok = ok && readU32(file, count);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        ForLoop loop;
+        uint32_t ret;
+        ok = readString(file, loop.variable) && readDouble(file, loop.start) &&
+             readDouble(file, loop.end) && readDouble(file, loop.step) &&
+             readU32(file, ret);
+        loop.returnLine = ret;
+        newForLoops.push_back(loop);
+    }
+    ok = ok && readU32(file, count) && count <= maxGosubDepth;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        uint32_t ret;
+        ok = readU32(file, ret);
+        newGosubStack.push_back(ret);
+    }
+    ok = ok && readU32(file, count);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        std::string value;
+        ok = readString(file, value);
+        newDataValues.push_back(value);
+    }
+    ok = ok && readU32(file, count);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        std::string name;
+        UserFunction fn;
+        uint32_t paramCount;
+        ok = readString(file, name) && readU32(file, paramCount);
+        for (uint32_t p = 0; ok && p < paramCount; p++) {
+            std::string param;
+            ok = readString(file, param);
+            fn.params.push_back(param);
+        }
+        ok = ok && readString(file, fn.source);
+        try {
+            if (ok) fn.body = ExprParser(fn.source, fn.params, false).parse();
+        } catch (...) {
+            ok = false;
+        }
+        newFunctions[name] = fn;
+    }
+
+    // Reject anything that would index out of bounds once restored
+    size_t lineCount = newProgram.size();
+    ok = ok && resumeLine <= lineCount && pointer <= newDataValues.size();
+    for (size_t i = 0; ok && i < newArrays.size(); i++) {
+        const Array& arr = newArrays[i];
+        size_t elements = 1;
+        ok = arr.dimensions[0] >= 0;
+        for (int d = 0; ok && d < 3; d++) {
+            if (arr.dimensions[d] < 0) {
+                ok = d == 2 || arr.dimensions[d + 1] < 0;  // Unused dims come last
+            } else {
+                elements *= static_cast<size_t>(arr.dimensions[d]) + 1;
+            }
+        }
+        ok = ok && elements == arr.values.size();
+    }
+    for (size_t i = 0; ok && i < newForLoops.size(); i++) {
+        ok = newForLoops[i].returnLine < lineCount;
+    }
+    for (size_t i = 0; ok && i < newGosubStack.size(); i++) {
+        ok = newGosubStack[i] <= lineCount;
+    }
+    if (!ok) {
+        *vm->out << "?BAD FILE FORMAT\n";
+        return false;
+    }
+
+    vm->program.swap(newProgram);
+    vm->variables.swap(newVariables);
+    vm->stringVars.swap(newStringVars);
+    vm->arrays.swap(newArrays);
+    vm->forLoops.swap(newForLoops);
+    std::copy(newGosubStack.begin(), newGosubStack.end(), vm->gosubStack);
+    vm->gosubDepth = newGosubStack.size();
+    vm->functions.swap(newFunctions);
+    vm->exprCache.clear();
+    vm->dataValues.swap(newDataValues);
+    vm->dataPointer = pointer;
+    // Keep snapshotting after a restart, or the next restart loses everything
+    vm->checkpointFile = target;
+    vm->checkpointInterval = interval;
+    vm->linesSinceCheckpoint = 0;
+    vm->currentLine = static_cast<int>(resumeLine);
+    vm->canContinue = true;
+    resolveJumps();
+    return true;
+}
+
+// Format: CHECKPOINT "file"[,lines] - snapshot now, and every n lines if given
+bool processCheckpoint(const std::string& cmd, size_t resumeLine) {
+    std::string args = cmd.substr(11);
+    size_t open = args.find('"');
+    size_t close = args.find('"', open + 1);
+    if (open == std::string::npos || close == std::string::npos) {
+        *vm->out << "?SYNTAX ERROR\n";
+        return false;
+    }
+    std::string filename = args.substr(open + 1, close - open - 1);
+    size_t comma = args.find(',', close);
+    if (comma != std::string::npos) {
+        try {
+            vm->checkpointInterval = std::stoul(args.substr(comma + 1));
+        } catch (...) {
+            *vm->out << "?SYNTAX ERROR\n";
+            return false;
+        }
+    }
+    vm->checkpointFile = filename;
+    vm->linesSinceCheckpoint = 0;
+    return writeCheckpoint(filename, resumeLine);
+}
+
+// Thread pool with one task queue per worker. Workers take their own
+// oldest task first (so requeued time slices round-robin fairly) and steal
+// the newest task from a sibling's queue when their own runs dry.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned threadCount) {
+        if (threadCount == 0) threadCount = 1;
+        for (unsigned i = 0; i < threadCount; i++) {
+            queues.emplace_back(new WorkQueue());
+        }
+        for (unsigned i = 0; i < threadCount; i++) {
+            threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> guard(idleLock);
+            stopping = true;
+        }
+        idleSignal.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Tasks submitted from a worker stay on that worker's queue
+    void submit(std::function<void()> task) {
+        unsigned target = (currentPool == this)
+            ? currentWorker
+            : nextQueue++ % static_cast<unsigned>(queues.size());
+        {
+            std::lock_guard<std::mutex> guard(queues[target]->lock);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        queued++;
+        {
+            std::lock_guard<std::mutex> guard(idleLock);
+        }
+        idleSignal.notify_one();
+    }
+
+    unsigned size() const {
+        return static_cast<unsigned>(threads.size());
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool popTask(unsigned self, std::function<void()>& task) {
+        for (size_t i = 0; i < queues.size(); i++) {
+            WorkQueue& queue = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty()) continue;
+            if (i == 0) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            } else {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned self) {
+        currentPool = this;
+        currentWorker = self;
+        while (true) {
+            std::function<void()> task;
+            if (popTask(self, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(idleLock);
+            idleSignal.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+        }
+    }
+
+    static thread_local WorkStealingPool* currentPool;
+    static thread_local unsigned currentWorker;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex idleLock;
+    std::condition_variable idleSignal;
+    std::atomic<size_t> queued{0};
+    std::atomic<unsigned> nextQueue{0};
+    bool stopping = false;
+};
+
+thread_local WorkStealingPool* WorkStealingPool::currentPool = nullptr;
+thread_local unsigned WorkStealingPool::currentWorker = 0;
+
+unsigned loopThreadCount() {
+    const char* setting = std::getenv("ZUIX_THREADS");
+    int threads = setting ? std::atoi(setting) : 0;
+    if (threads > 0) return static_cast<unsigned>(threads);
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 0 ? cores : 1;
+}
+
+// Shared by every machine; created on the first PARALLEL FOR
+WorkStealingPool& loopPool() {
+    static WorkStealingPool pool(loopThreadCount());
+    return pool;
+}
+
+// PARALLEL FOR I = a TO b [STEP s] [SUM v | MAX v] ... NEXT I
+//
+// A loop runs in parallel only when every body line is a REM or an
+// assignment to X(I), I being the loop variable, or to the reduction
+// variable as v = v + expr (SUM) or v = MAX(v, expr) (MAX), and the start
+// and STEP are whole numbers so each iteration owns its X(I). Arrays the body
+// writes may only be read back at X(I), and called functions may not read
+// them at all. Any other loop runs as an ordinary FOR.
+struct ParallelLoop {
+    std::string variable;
+    double start = 0;
+    double end = 0;
+    double step = 1;
+    char reduction = 0;         // '+' for SUM, 'M' for MAX, 0 for none
+    std::string reductionVar;
+    int nextLine = -1;          // Index of the matching NEXT
+    struct Store {
+        Array* target;          // nullptr for a reduction contribution
+        ExprPtr value;
+    };
+    std::vector<Store> body;
+};
+
+// Split "PARALLEL FOR ... [SUM v | MAX v]" into a plain FOR line and the clause
+std::string splitParallelHeader(const std::string& cmd, ParallelLoop& loop) {
+    std::string forText = cmd.substr(9);
+    size_t toPos = forText.find("TO");
+    size_t clause = std::string::npos;
+    if (toPos != std::string::npos) {
+        size_t sum = forText.find(" SUM ", toPos);
+        size_t max = forText.find(" MAX ", toPos);
+        clause = std::min(sum, max);
+    }
+    if (clause != std::string::npos) {
+        loop.reduction = forText.compare(clause, 5, " SUM ") == 0 ? '+' : 'M';
+        loop.reductionVar = forText.substr(clause + 5);
+        loop.reductionVar.erase(std::remove(loop.reductionVar.begin(),
+                                            loop.reductionVar.end(), ' '),
+                                loop.reductionVar.end());
+        forText = forText.substr(0, clause);
+    }
+    return forText;
+}
+
+bool isLoopIndex(const Expr& e) {
+    return e.kind == Expr::PARAM && e.slot == 0;
+}
+
+// True when evaluating e cannot observe another iteration's writes
+bool readsAreIndependent(const Expr& e, const ParallelLoop& loop,
+                         const std::set<std::string>& written, bool inFunction, int depth) {
+    // The loop variable itself is a frame slot; by name it can only come
+    // from a function body, which would see a stale value
+    if (e.kind == Expr::VARIABLE &&
+        (e.name == loop.reductionVar || e.name == loop.variable)) {
+        return false;
+    }
+    if (e.kind == Expr::ARRAY && written.count(e.name) &&
+        (inFunction || e.args.size() != 1 || !isLoopIndex(*e.args[0]))) {
+        return false;
+    }
+    if (e.kind == Expr::FILE_FN) return false;  // EOF() may read ahead
+    if (e.kind == Expr::USER_FN) {
+        auto fn = vm->functions.find(e.name);
+        if (fn == vm->functions.end() || depth > 8 ||
+            !readsAreIndependent(*fn->second.body, loop, written, true, depth + 1)) {
+            return false;
+        }
+    }
+    for (const auto& arg : e.args) {
+        if (!readsAreIndependent(*arg, loop, written, inFunction, depth)) return false;
+    }
+    return true;
+}
+
+// Fill in loop from the PARALLEL FOR at currentLine; false if not eligible
+bool analyzeParallelLoop(const std::string& cmd, ParallelLoop& loop) {
+    std::string forText = splitParallelHeader(cmd, loop);
+    size_t eqPos = forText.find('=');
+    size_t toPos = forText.find("TO");
+    if (eqPos == std::string::npos || toPos == std::string::npos) return false;
+    loop.variable = forText.substr(4, eqPos - 4);
+    loop.variable.erase(std::remove(loop.variable.begin(), loop.variable.end(), ' '),
+                        loop.variable.end());
+    size_t stepPos = forText.find("STEP");
+    loop.start = evaluate(forText.substr(eqPos + 1, toPos - eqPos - 1));
+    if (stepPos != std::string::npos) {
+        loop.end = evaluate(forText.substr(toPos + 2, stepPos - toPos - 2));
+        loop.step = evaluate(forText.substr(stepPos + 4));
+    } else {
+        loop.end = evaluate(forText.substr(toPos + 2));
+    }
+    if (loop.step == 0 || loop.variable.empty() || loop.variable == loop.reductionVar) {
+        return false;
+    }
+    // X(I) truncates I, so fractional starts or steps below 1 could send two
+    // iterations (possibly in different chunks) to the same element
+    if (loop.start != floor(loop.start) || loop.step != floor(loop.step) ||
+        std::fabs(loop.step) < 1) {
+        return false;
+    }
+
+    const std::vector<std::string> params(1, loop.variable);
+    std::set<std::string> written;
+    for (size_t i = vm->currentLine + 1; i < vm->program.size(); i++) {
+        std::string line = vm->program[i].content;
+        if (line == "NEXT" || line.substr(0, 5) == "NEXT ") {
+            loop.nextLine = static_cast<int>(i);
+            break;
+        }
+        if (line.substr(0, 4) == "REM " || line == "REM") continue;
+        if (line.substr(0, 4) == "LET ") line = line.substr(4);
+        size_t eq = line.find('=');
+        if (eq == std::string::npos || !isalpha(line[0])) return false;
+
+        ExprPtr target = ExprParser(line.substr(0, eq), params, true).parse();
+        ExprPtr value = ExprParser(line.substr(eq + 1), params, true).parse();
+        ParallelLoop::Store store;
+        store.target = nullptr;
+        if (target->kind == Expr::ARRAY && target->args.size() == 1 &&
+            isLoopIndex(*target->args[0])) {
+            store.target = findArray(target->name);
+            if (!store.target || store.target->dimensions[1] >= 0) return false;
+            written.insert(target->name);
+            store.value = value;
+        } else if (target->kind == Expr::VARIABLE && target->name == loop.reductionVar &&
+                   value->kind == Expr::BINARY && value->op == loop.reduction) {
+            // Keep only the contribution: v + e, e + v, MAX(v, e) or MAX(e, v)
+            const Expr& left = *value->args[0];
+            bool leftIsVar = left.kind == Expr::VARIABLE && left.name == loop.reductionVar;
+            store.value = value->args[leftIsVar ? 1 : 0];
+            const Expr& other = *value->args[leftIsVar ? 0 : 1];
+            if (other.kind != Expr::VARIABLE || other.name != loop.reductionVar) return false;
+        } else {
+            return false;
+        }
+        loop.body.push_back(store);
+    }
+    if (loop.nextLine < 0 || loop.body.empty()) return false;
+    for (const auto& store : loop.body) {
+        if (!readsAreIndependent(*store.value, loop, written, false, 0)) return false;
+    }
+    return true;
+}
+
+// Split the iterations into chunks on loopPool(); false if an iteration failed
+// Runs a PARALLEL FOR in rounds of at most parallelRoundLines lines. Between
+// rounds it checks for Ctrl-C, SIGTERM and the wall-time limit, and sizes the
+// next round to fit the instruction limit, the slice budget and the next
+// periodic checkpoint. When a round no longer fits, or is too short to be
+// worth spreading over the pool, the rest of the loop is handed to FOR/NEXT,
+// which stops, yields and checkpoints it line by line. Periodic checkpoints
+// record the loop the same way, as a FOR frame at the next iteration.
+const size_t parallelRoundLines = 1 << 20;
+const size_t parallelMinimumLines = 4096;
+
+bool runParallelLoop(const ParallelLoop& loop, unsigned long budget, unsigned long& executed) {
+    // Like FOR/NEXT, the body always runs at least once
+    double span = floor((loop.end - loop.start) / loop.step);
+    size_t iterations = span > 0 ? static_cast<size_t>(span) + 1 : 1;
+    size_t cost = loop.body.size() + 1;  // Lines per iteration, NEXT included
+    WorkStealingPool& pool = loopPool();
+    double identity = loop.reduction == 'M' ? -HUGE_VAL : 0;
+    Machine* machine = vm;
+    size_t finished = 0;
+
+    // Leave the loop as FOR/NEXT would hold it before iteration finished
+    auto handOff = [&] {
+        ForLoop rest;
+        rest.variable = loop.variable;
+        rest.start = loop.start;
+        rest.end = loop.end;
+        rest.step = loop.step;
+        rest.returnLine = static_cast<size_t>(vm->currentLine);
+        vm->forLoops.push_back(rest);
+        setVariable(loop.variable, loop.start + finished * loop.step);
+        vm->currentLine++;
+    };
+
+    while (finished < iterations) {
+        // Snapshot at the last iteration boundary before the interval runs out
+        if (vm->checkpointInterval > 0 &&
+            vm->linesSinceCheckpoint + cost > vm->checkpointInterval) {
+            vm->linesSinceCheckpoint = 0;
+            handOff();
+            writeCheckpoint(vm->checkpointFile, vm->currentLine);
+            vm->forLoops.pop_back();
+            vm->currentLine--;
+        }
+        size_t lines = parallelRoundLines;
+        if (budget > 0) lines = std::min<size_t>(lines, budget - std::min(executed, budget));
+        if (vm->maxInstructions > 0) {
+            lines = std::min<size_t>(lines, vm->instructionCount < vm->maxInstructions
+                                                ? vm->maxInstructions - vm->instructionCount
+                                                : 0);
+        }
+        if (vm->checkpointInterval > 0) {
+            lines = std::min<size_t>(lines, vm->checkpointInterval - vm->linesSinceCheckpoint);
+        }
+        bool interrupted = vm->interactive && (breakRequested || terminateRequested);
+        bool outOfTime = vm->maxWallTime.count() > 0 &&
+                         std::chrono::steady_clock::now() - vm->startTime > vm->maxWallTime;
+        size_t round = std::min(iterations - finished, lines / cost);
+        bool tooShort = round < iterations - finished && round * cost < parallelMinimumLines;
+        if (interrupted || outOfTime || round == 0 || tooShort) {
+            handOff();
+            return true;
+        }
+
+        size_t chunks = std::min(round, static_cast<size_t>(pool.size()) * 8);
+        size_t chunkSize = (round + chunks - 1) / chunks;
+        chunks = (round + chunkSize - 1) / chunkSize;
+        std::vector<double> partials(chunks, identity);
+        std::mutex doneLock;
+        std::condition_variable done;
+        size_t remaining = chunks;
+        std::string error;
+
+        for (size_t c = 0; c < chunks; c++) {
+            pool.submit([&, c] {
+                Machine* previous = vm;
+                vm = machine;
+                double partial = identity;
+                double frame[1];
+                size_t last = finished + std::min(round, (c + 1) * chunkSize);
+                try {
+                    for (size_t k = finished + c * chunkSize; k < last; k++) {
+                        frame[0] = loop.start + k * loop.step;
+                        for (const auto& store : loop.body) {
+                            double value = evalExpr(*store.value, frame);
+                            if (store.target) {
+                                store.target->values[arrayOffset(*store.target, frame, 1)] = value;
+                            } else if (loop.reduction == '+') {
+                                partial += value;
+                            } else if (value > partial) {
+                                partial = value;
+                            }
+                        }
+                    }
+                } catch (const std::runtime_error& e) {
+                    std::lock_guard<std::mutex> guard(doneLock);
+                    if (error.empty()) error = e.what();
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(doneLock);
+                    if (error.empty()) error = "?INTERNAL ERROR";
+                }
+                partials[c] = partial;
+                vm = previous;
+                std::lock_guard<std::mutex> guard(doneLock);
+                if (--remaining == 0) done.notify_one();
+            });
+        }
+        {
+            std::unique_lock<std::mutex> lock(doneLock);
+            done.wait(lock, [&] { return remaining == 0; });
+        }
+        if (!error.empty()) {
+            *vm->out << error << "\n";
+            return false;
+        }
+
+        if (loop.reduction) {
+            double total = getVariable(loop.reductionVar);
+            for (double partial : partials) {
+                total = loop.reduction == '+' ? total + partial : std::max(total, partial);
+            }
+            setVariable(loop.reductionVar, total);
+        }
+        finished += round;
+        vm->instructionCount += round * cost;
+        executed += static_cast<unsigned long>(round * cost);
+        if (vm->checkpointInterval > 0) vm->linesSinceCheckpoint += round * cost;
+    }
+    setVariable(loop.variable, loop.start + (iterations - 1) * loop.step);
+    vm->currentLine = loop.nextLine + 1;
+    return true;
+}
+
+enum RunState {
+    RUN_DONE,           // Ran off the end, hit an error or RETURN underflow
+    RUN_YIELDED,        // Used up its instruction budget, call again
+    RUN_WAITING_INPUT,  // Blocked on INPUT with nothing in pendingInput
+    RUN_STOPPED,        // STOP or Ctrl-C, CONT resumes
+    RUN_LIMIT           // Instruction, memory or wall-time limit exceeded
+};
+
+// Returns false (and reports why) once a machine is over one of its limits
+// True when the current line starts an iteration of a PARALLEL FOR that
+// runParallelLoop handed to FOR/NEXT
+bool atParallelIteration() {
+    if (vm->forLoops.empty()) return false;
+    const ForLoop& top = vm->forLoops.back();
+    return top.returnLine + 1 == static_cast<size_t>(vm->currentLine) &&
+           vm->program[top.returnLine].content.compare(0, 13, "PARALLEL FOR ") == 0;
+}
+
+// At such a line, fills loop with the iterations left and drops the FOR frame
+// so the parallel path can take them over; false if the loop is no longer
+// eligible
+bool resumableParallelLoop(ParallelLoop& loop) {
+    const ForLoop& top = vm->forLoops.back();
+    int line = vm->currentLine;
+    vm->currentLine = static_cast<int>(top.returnLine);
+    bool eligible;
+    try {
+        eligible = analyzeParallelLoop(vm->program[top.returnLine].content, loop);
+    } catch (...) {
+        eligible = false;
+    }
+    if (!eligible || loop.variable != top.variable) {
+        vm->currentLine = line;
+        return false;
+    }
+    loop.start = getVariable(loop.variable);
+    loop.end = top.end;
+    loop.step = top.step;
+    vm->forLoops.pop_back();
+    return true;
+}
+
+bool withinLimits(Machine& m) {
+    if (m.maxInstructions > 0 && m.instructionCount >= m.maxInstructions) {
+        *m.out << "?INSTRUCTION LIMIT EXCEEDED\n";
+        return false;
+    }
+    if (m.maxMemory > 0 && machineMemory(m) > m.maxMemory) {
+        *m.out << "?OUT OF MEMORY\n";
+        return false;
+    }
+    if (m.maxWallTime.count() > 0 &&
+        std::chrono::steady_clock::now() - m.startTime > m.maxWallTime) {
+        *m.out << "?TIME LIMIT EXCEEDED\n";
+        return false;
+    }
+    return true;
+}
+
+// Execute up to budget lines (0 = no budget) of a machine's program and
+// report why it came back. Resumable: calling again carries on at currentLine.
+RunState stepProgram(Machine& m, unsigned long budget) {
+    Machine* previous = vm;
+    vm = &m;
+    vm->isRunning = true;
+    vm->canContinue = false;
+    RunState state = RUN_DONE;
+    unsigned long executed = 0;
+    bool parallelTried = false;  // Resume a handed-off loop at most once a call
+    if (vm->lineTargets.size() != vm->program.size()) {
+        resolveJumps();
+    }
+
+    while (vm->currentLine < static_cast<int>(vm->program.size()) && vm->isRunning) {
+        if (budget > 0 && executed++ >= budget) {
+            state = RUN_YIELDED;
+            break;
+        }
+        // Wall time and memory are too costly to check on every line
+        if (((vm->instructionCount & 1023) == 0 ||
+             vm->instructionCount == vm->maxInstructions) && !withinLimits(*vm)) {
+            state = RUN_LIMIT;
+            break;
+        }
+        vm->instructionCount++;
+
+        if (vm->interactive && (breakRequested || terminateRequested)) {
+            *vm->out << "BREAK IN " << vm->program[vm->currentLine].number << "\n";
+            vm->canContinue = true;
+            if (terminateRequested) {
+                if (!vm->checkpointFile.empty()) {
+                    writeCheckpoint(vm->checkpointFile, vm->currentLine);
+                }
+                std::exit(128 + SIGTERM);
+            }
+            state = RUN_STOPPED;
+            break;
+        }
+        if (vm->checkpointInterval > 0 && ++vm->linesSinceCheckpoint >= vm->checkpointInterval) {
+            vm->linesSinceCheckpoint = 0;
+            writeCheckpoint(vm->checkpointFile, vm->currentLine);
+        }
+        // CONT, a restored checkpoint or a new slice may resume inside a
+        // PARALLEL FOR that was handed to FOR/NEXT
+        if (!parallelTried && atParallelIteration()) {
+            parallelTried = true;
+            ParallelLoop loop;
+            if (resumableParallelLoop(loop)) {
+                if (!runParallelLoop(loop, budget, executed)) break;
                 continue;
+            }
+        }
+
+        std::string cmd = vm->program[vm->currentLine].content;
+
+        if (cmd.compare(0, 3, "IF ") == 0) {
+            // Format: IF condition THEN line | IF condition THEN statement
+            size_t thenPos = cmd.find("THEN");
+            if (thenPos == std::string::npos) {
+                *vm->out << "?SYNTAX ERROR\n";
+                break;
+            }
+            bool taken;
+            try {
+                taken = evaluate(cmd.substr(3, thenPos - 3)) != 0;
+            } catch (const std::runtime_error& e) {
+                *vm->out << e.what() << "\n";
+                break;
             } catch (...) {
-                std::cout << "?SYNTAX ERROR\n";
+                *vm->out << "?SYNTAX ERROR\n";
+                break;
+            }
+            if (!taken) {
+                vm->currentLine++;
+                continue;
+            }
+            size_t action = cmd.find_first_not_of(' ', thenPos + 4);
+            if (action == std::string::npos || cmd.substr(action, 3) == "IF ") {
+                *vm->out << "?SYNTAX ERROR\n";
+                break;
+            }
+            if (isdigit(cmd[action]) || cmd.substr(action, 4) == "GOTO") {
+                int target = vm->lineTargets[vm->currentLine];
+                if (target < 0) {
+                    *vm->out << "?UNDEFINED LINE NUMBER\n";
+                    break;
+                }
+                vm->currentLine = target;
+                continue;
+            }
+            cmd = cmd.substr(action);  // Run the statement in place of the IF
+        }
+
+        if (cmd == "STOP") {
+            *vm->out << "BREAK IN " << vm->program[vm->currentLine].number << "\n";
+            vm->currentLine++;
+            vm->canContinue = true;
+            state = RUN_STOPPED;
+            break;
+        }
+        else if (cmd == "END") {
+            break;
+        }
+        else if (cmd.compare(0, 11, "CHECKPOINT ") == 0) {
+            processCheckpoint(cmd, vm->currentLine + 1);
+        }
+        else if (cmd.compare(0, 7, "PRINT #") == 0) {
+            processPrintFile(cmd);
+        }
+        else if (cmd.compare(0, 6, "PRINT ") == 0) {
+            processPrint(cmd);
+        }
+        else if (cmd.compare(0, 4, "LET ") == 0) {
+            processLet(cmd);
+        }
+        else if (cmd.compare(0, 5, "GOTO ") == 0) {
+            int target = vm->lineTargets[vm->currentLine];
+            if (target < 0) {
+                *vm->out << "?UNDEFINED LINE NUMBER\n";
                 break;
             }
+            vm->currentLine = target;
+            continue;
         }
-        else if (cmd.substr(0, 4) == "FOR ") {
+        else if (cmd.compare(0, 4, "DEF ") == 0) {
+            processDef(cmd);
+        }
+        else if (cmd.compare(0, 4, "FOR ") == 0) {
             processFor(cmd);
         }
-        else if (cmd.substr(0, 5) == "NEXT ") {
+        else if (cmd.compare(0, 13, "PARALLEL FOR ") == 0) {
+            ParallelLoop loop;
+            bool eligible;
+            try {
+                eligible = analyzeParallelLoop(cmd, loop);
+            } catch (...) {
+                eligible = false;  // processFor reports the error
+            }
+            if (eligible) {
+                parallelTried = true;
+                if (!runParallelLoop(loop, budget, executed)) break;
+                continue;
+            }
+            processFor(splitParallelHeader(cmd, loop));
+        }
+        else if (cmd.compare(0, 5, "NEXT ") == 0) {
             processNext(cmd);
             continue;  // Skip currentLine increment if loop continues
         }
-        else if (cmd.substr(0, 6) == "INPUT ") {
-            processInput(cmd);
+        else if (cmd.compare(0, 7, "INPUT #") == 0) {
+            processInputFile(cmd);
         }
-        else if (cmd.substr(0, 6) == "GOSUB ") {
-            try {
-                int lineNum = std::stoi(cmd.substr(6));
-                gosubStack.push_back(currentLine);
-                gotoLine(lineNum);
-                continue;
-            } catch (...) {
-                std::cout << "?SYNTAX ERROR\n";
+        else if (cmd.compare(0, 12, "LINE INPUT #") == 0) {
+            processLineInputFile(cmd);
+        }
+        else if (cmd.compare(0, 5, "OPEN ") == 0) {
+            processOpen(cmd);
+        }
+        else if (cmd == "CLOSE" || cmd.compare(0, 6, "CLOSE ") == 0) {
+            processClose(cmd);
+        }
+        else if (cmd.compare(0, 6, "FIELD ") == 0) {
+            processField(cmd);
+        }
+        else if (cmd.compare(0, 4, "GET ") == 0 || cmd.compare(0, 4, "PUT ") == 0) {
+            processGetPut(cmd, cmd[0] == 'P');
+        }
+        else if (cmd.compare(0, 6, "INPUT ") == 0) {
+            if (!processInput(cmd)) {
+                if (vm->interactive) continue;  // Break, or checkpoint and exit, at the loop top
+                state = RUN_WAITING_INPUT;  // Retry this line once input arrives
+                break;
             }
         }
+        else if (cmd.compare(0, 6, "GOSUB ") == 0) {
+            int target = vm->lineTargets[vm->currentLine];
+            if (target < 0) {
+                *vm->out << "?UNDEFINED LINE NUMBER\n";
+                break;
+            }
+            if (vm->gosubDepth == maxGosubDepth) {
+                *vm->out << "?GOSUB STACK OVERFLOW IN " << vm->program[vm->currentLine].number << "\n";
+                break;
+            }
+            vm->gosubStack[vm->gosubDepth++] = vm->currentLine + 1;
+            vm->currentLine = target;
+            continue;
+        }
         else if (cmd == "RETURN") {
-            if (gosubStack.empty()) {
-                std::cout << "?RETURN WITHOUT GOSUB\n";
-                return;
+            if (vm->gosubDepth == 0) {
+                *vm->out << "?RETURN WITHOUT GOSUB\n";
+                break;
             }
-            currentLine = gosubStack.back();
-            gosubStack.pop_back();
+            vm->currentLine = vm->gosubStack[--vm->gosubDepth];
+            continue;
         }
-        else if (cmd.substr(0, 4) == "DIM ") {
+        else if (cmd.compare(0, 4, "DIM ") == 0) {
             dimArray(cmd);
         }
-        else if (cmd.substr(0, 5) == "SAVE ") {
+        else if (cmd.compare(0, 5, "SAVE ") == 0) {
             saveProgram(cmd.substr(5));
         }
-        else if (cmd.substr(0, 5) == "LOAD ") {
+        else if (cmd.compare(0, 5, "LOAD ") == 0) {
             loadProgram(cmd.substr(5));
         }
-        else if (cmd.substr(0, 5) == "LINE ") {
+        else if (cmd.compare(0, 5, "LINE ") == 0) {
             // Parse coordinates and call drawLine
             // Format: LINE x1,y1,x2,y2
             std::stringstream ss(cmd.substr(5));
@@ -593,7 +2666,7 @@ void runProgram() {
             ss >> x1 >> comma >> y1 >> comma >> x2 >> comma >> y2;
             drawLine(x1, y1, x2, y2);
         }
-        else if (cmd.substr(0, 7) == "CIRCLE ") {
+        else if (cmd.compare(0, 7, "CIRCLE ") == 0) {
             // Parse parameters and call drawCircle
             // Format: CIRCLE x,y,radius
             std::stringstream ss(cmd.substr(7));
@@ -602,36 +2675,361 @@ void runProgram() {
             ss >> x >> comma >> y >> comma >> radius;
             drawCircle(x, y, radius);
         }
-        else if (cmd.substr(0, 5) == "PLAY ") {
+        else if (cmd.compare(0, 5, "PLAY ") == 0) {
             // Format: PLAY "CDEFGAB"
             std::string notes = cmd.substr(5);
             for (char note : notes) {
                 if (note != ' ') playNote(std::string(1, note));
             }
         }
+        else if (!cmd.empty() && isalpha(cmd[0]) && cmd.find('=') != std::string::npos) {
+            processLet("LET " + cmd);  // Assignment without LET
+        }
         
-        currentLine++;
+        vm->currentLine++;
     }
     
-    isRunning = false;
+    if (state != RUN_YIELDED && state != RUN_WAITING_INPUT) {
+        vm->isRunning = false;
+    }
+    if (state == RUN_DONE || state == RUN_LIMIT) {
+        vm->channels.clear();  // Flush and close data files
+    }
+    vm = previous;
+    return state;
+}
+
+void executeProgram() {
+    breakRequested = 0;
+    stepProgram(console, 0);
+}
+
+void runProgram() {
+    if (vm->program.empty()) {
+        *vm->out << "NO PROGRAM\n";
+        return;
+    }
+
+    vm->currentLine = 0;
+    vm->forLoops.clear();
+    vm->gosubDepth = 0;
+    vm->functions.clear();
+    vm->exprCache.clear();
+    vm->channels.clear();
+    vm->checkpointFile.clear();  // A new run sets its own CHECKPOINT target
+    vm->checkpointInterval = 0;
+    vm->linesSinceCheckpoint = 0;
+    resolveJumps();
+    executeProgram();
+}
+
+// CONT resumes after STOP/Ctrl-C; CONT "file" resumes from a checkpoint
+void continueProgram(const std::string& cmd) {
+    if (cmd.size() > 5) {
+        std::string filename = cmd.substr(5);
+        filename.erase(std::remove(filename.begin(), filename.end(), '"'), filename.end());
+        if (!readCheckpoint(filename)) return;
+    }
+    if (!vm->canContinue) {
+        *vm->out << "?CAN'T CONTINUE\n";
+        return;
+    }
+    executeProgram();
+}
+
+struct MachineLimits {
+    unsigned long long maxInstructions = 0;
+    size_t maxMemory = 0;
+    std::chrono::milliseconds maxWallTime{0};
+};
+
+// Multiplexes many non-interactive programs over a WorkStealingPool. Each
+// turn runs one slice of sliceLength lines and requeues the program; a
+// program blocked on INPUT is parked until feedInput() gives it a line.
+// A finished program keeps its output until release() frees it.
+class Scheduler {
+public:
+    struct Job {
+        int id;
+        Machine machine;
+        std::ostringstream output;
+        RunState state = RUN_YIELDED;
+        unsigned long slices = 0;
+        std::chrono::steady_clock::time_point finishTime;
+
+        std::mutex lock;  // Guards inbox and parked
+        std::deque<std::string> inbox;
+        bool parked = false;
+        bool finished = false;  // Guarded by the scheduler's jobsLock
+    };
+
+    Scheduler(unsigned threadCount, unsigned long sliceLength)
+        : pool(threadCount), sliceLength(sliceLength) {}
+
+    ~Scheduler() {
+        cancelAll();
+        waitAll();
+    }
+
+    int spawn(const std::vector<Line>& program, const MachineLimits& limits) {
+        Job* job = new Job();
+        job->machine.program = program;
+        job->machine.interactive = false;
+        job->machine.out = &job->output;
+        job->machine.maxInstructions = limits.maxInstructions;
+        job->machine.maxMemory = limits.maxMemory;
+        job->machine.maxWallTime = limits.maxWallTime;
+        job->machine.startTime = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> guard(jobsLock);
+            job->id = nextId++;
+            jobs[job->id].reset(job);
+            active++;
+        }
+        pool.submit([this, job] { runSlice(job); });
+        return job->id;
+    }
+
+    void feedInput(int id, const std::string& line) {
+        Job* job;
+        {
+            std::lock_guard<std::mutex> guard(jobsLock);
+            job = jobs.at(id).get();
+        }
+        bool wake;
+        {
+            std::lock_guard<std::mutex> guard(job->lock);
+            job->inbox.push_back(line);
+            wake = job->parked;
+            job->parked = false;
+        }
+        if (wake) {
+            pool.submit([this, job] { runSlice(job); });
+        }
+    }
+
+    // Finish parked programs and stop requeueing the rest; cancelled
+    // programs end with RUN_STOPPED
+    void cancelAll() {
+        cancelling = true;
+        std::vector<Job*> parked;
+        {
+            std::lock_guard<std::mutex> guard(jobsLock);
+            for (const auto& entry : jobs) {
+                Job* job = entry.second.get();
+                std::lock_guard<std::mutex> jobGuard(job->lock);
+                if (job->parked) {
+                    job->parked = false;
+                    parked.push_back(job);
+                }
+            }
+        }
+        for (Job* job : parked) {
+            job->state = RUN_STOPPED;
+            finish(job);
+        }
+    }
+
+    // Blocks until every program has finished; parked programs only finish
+    // through feedInput() or cancelAll()
+    void waitAll() {
+        std::unique_lock<std::mutex> lock(jobsLock);
+        allDone.wait(lock, [this] { return active == 0; });
+    }
+
+    // Blocks until one program has finished and returns how it ended
+    RunState wait(int id) {
+        std::unique_lock<std::mutex> lock(jobsLock);
+        Job* job = jobs.at(id).get();
+        allDone.wait(lock, [job] { return job->finished; });
+        return job->state;
+    }
+
+    // Only safe to inspect once the job has finished, and until release()
+    const Job& job(int id) {
+        std::lock_guard<std::mutex> guard(jobsLock);
+        return *jobs.at(id);
+    }
+
+    // Frees a finished program's machine and output; false while it runs
+    bool release(int id) {
+        std::unique_ptr<Job> done;
+        std::lock_guard<std::mutex> guard(jobsLock);
+        auto found = jobs.find(id);
+        if (found == jobs.end() || !found->second->finished) return false;
+        done = std::move(found->second);
+        jobs.erase(found);
+        return true;
+    }
+
+private:
+    void runSlice(Job* job) {
+        if (cancelling) {
+            job->state = RUN_STOPPED;
+            finish(job);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(job->lock);
+            for (const auto& line : job->inbox) {
+                job->machine.pendingInput.push_back(line);
+            }
+            job->inbox.clear();
+        }
+        // One program's failure must not take the worker, and with it
+        // every other program, down
+        Machine* previous = vm;
+        try {
+            job->state = stepProgram(job->machine, sliceLength);
+        } catch (const std::exception& e) {
+            vm = previous;
+            job->output << "?INTERNAL ERROR: " << e.what() << "\n";
+            job->state = RUN_DONE;
+        } catch (...) {
+            vm = previous;
+            job->output << "?INTERNAL ERROR\n";
+            job->state = RUN_DONE;
+        }
+        job->slices++;
+
+        if (job->state == RUN_WAITING_INPUT) {
+            // Checked under the job lock so cancelAll() cannot miss a park
+            std::lock_guard<std::mutex> guard(job->lock);
+            job->parked = job->inbox.empty() && !cancelling;
+            if (job->parked) return;
+        }
+        if (job->state == RUN_YIELDED || job->state == RUN_WAITING_INPUT) {
+            pool.submit([this, job] { runSlice(job); });
+            return;
+        }
+        finish(job);
+    }
+
+    void finish(Job* job) {
+        job->finishTime = std::chrono::steady_clock::now();
+        job->machine.isRunning = false;
+        job->machine.channels.clear();  // A finished program never resumes
+        {
+            std::lock_guard<std::mutex> guard(jobsLock);
+            job->finished = true;
+            active--;
+        }
+        allDone.notify_all();
+    }
+
+    std::mutex jobsLock;
+    std::condition_variable allDone;
+    std::unordered_map<int, std::unique_ptr<Job>> jobs;
+    int nextId = 0;
+    size_t active = 0;
+    std::atomic<bool> cancelling{false};
+    WorkStealingPool pool;  // Last, so workers stop before the jobs go away
+    unsigned long sliceLength;
+};
+
+// zuix --bench-scheduler [programs] [threads]
+// Each program loops, blocks on INPUT until the bench feeds it a line, then
+// loops again and prints the input. Reports line throughput and Jain's
+// fairness index over the programs' completion times (1.0 = all equal).
+int benchScheduler(int programs, unsigned threads) {
+    const std::vector<Line> program = {
+        {10, "FOR I=1 TO 2000"}, {20, "NEXT I"}, {30, "INPUT X"},
+        {40, "FOR J=1 TO 2000"}, {50, "NEXT J"}, {60, "PRINT X"}};
+    MachineLimits limits;
+    limits.maxInstructions = 100000;
+    limits.maxWallTime = std::chrono::milliseconds(600000);
+
+    Scheduler scheduler(threads, 500);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < programs; i++) {
+        scheduler.spawn(program, limits);
+    }
+    for (int i = 0; i < programs; i++) {
+        scheduler.feedInput(i, std::to_string(i));
+    }
+    scheduler.waitAll();
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    unsigned long long lines = 0;
+    double sum = 0, sumSquares = 0, worst = 0;
+    int correct = 0;
+    for (int i = 0; i < programs; i++) {
+        const Scheduler::Job& job = scheduler.job(i);
+        double latency = std::chrono::duration<double>(
+            job.finishTime - job.machine.startTime).count();
+        lines += job.machine.instructionCount;
+        sum += latency;
+        sumSquares += latency * latency;
+        worst = std::max(worst, latency);
+        if (job.output.str() == std::to_string(i) + "\n") correct++;
+    }
+    std::cout << "programs=" << programs << " threads=" << threads
+              << " correct=" << correct << " time=" << seconds << "s"
+              << " lines/s=" << lines / seconds
+              << " mean-latency=" << sum / programs << "s"
+              << " max-latency=" << worst << "s"
+              << " fairness=" << sum * sum / (programs * sumSquares) << "\n";
+    return correct == programs ? 0 : 1;
 }
 
-int main() {
+// SIGTERM at the prompt: snapshot a stopped program to its CHECKPOINT
+// target first, as a running one does, then exit
+void terminateAtPrompt() {
+    if (vm->canContinue && !vm->checkpointFile.empty()) {
+        writeCheckpoint(vm->checkpointFile, vm->currentLine);
+    }
+    std::exit(128 + SIGTERM);
+}
+
+int main(int argc, char* argv[]) {
     std::string command;
     std::string name;
     bool running = true;
     std::random_device rd;
     std::mt19937 gen(rd());
     
+    if (argc > 1 && std::string(argv[1]) == "--bench-scheduler") {
+        int programs = argc > 2 ? std::atoi(argv[2]) : 10000;
+        unsigned threads = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : loopThreadCount();
+        return benchScheduler(programs > 0 ? programs : 1, threads);
+    }
+    
+#ifdef _WIN32
+    std::signal(SIGINT, handleBreakSignal);
+    std::signal(SIGTERM, handleTerminateSignal);
+#else
+    // No SA_RESTART, so both signals also interrupt a read at the prompt or
+    // in INPUT instead of waiting for the next line
+    struct sigaction interrupt = {};
+    interrupt.sa_handler = handleBreakSignal;
+    sigemptyset(&interrupt.sa_mask);
+    sigaction(SIGINT, &interrupt, nullptr);
+    struct sigaction terminate = {};
+    terminate.sa_handler = handleTerminateSignal;
+    sigemptyset(&terminate.sa_mask);
+    sigaction(SIGTERM, &terminate, nullptr);
+#endif
+    
     clearScreen();
     std::cout << "ZUIX-DOS Version 1.0 - BASIC Mode\n";
     std::cout << "Memory Size: 64K\n";
     std::cout << "Enter HELP for commands\n\n";
     
     while (running) {
+        if (terminateRequested) terminateAtPrompt();
         std::cout << "READY.\nA> ";
         
-        std::getline(std::cin, command);
+        if (!std::getline(std::cin, command)) {
+            if (breakRequested || terminateRequested) {
+                // Interrupted read, not end of input
+                breakRequested = 0;
+                std::cin.clear();
+                std::cout << "\n";
+                continue;
+            }
+            break;  // End of input
+        }
         
         // Convert command to uppercase before processing
         std::transform(command.begin(), command.end(), command.begin(), ::toupper);
@@ -645,8 +3043,19 @@ int main() {
         else if (command == "RUN") {
             runProgram();
         }
+        else if (command == "CONT" || command.substr(0, 5) == "CONT ") {
+            continueProgram(command);
+        }
+        else if (command.substr(0, 11) == "CHECKPOINT ") {
+            // Snapshot a stopped program so another process can CONT it
+            if (!vm->canContinue) {
+                std::cout << "?CAN'T CONTINUE\n";
+            } else if (processCheckpoint(command, vm->currentLine)) {
+                std::cout << "OK\n";
+            }
+        }
         else if (command == "LIST") {
-            for (const auto& line : program) {
+            for (const auto& line : vm->program) {
                 std::cout << line.number << " " << line.content << "\n";
             }
         }
@@ -695,7 +3104,7 @@ int main() {
             processRead(command);
         }
         else if (command == "RESTORE") {
-            dataPointer = 0;
+            vm->dataPointer = 0;
             std::cout << "OK\n";
         }
         else if (command.substr(0, 4) == "REM ") {